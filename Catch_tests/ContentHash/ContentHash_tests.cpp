@@ -0,0 +1,38 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <string>
+#include <unordered_set>
+#include <ContentHash.h>
+
+SCENARIO( "ContentHash", "[hash]" ) {
+	GIVEN( "Known strings" ) {
+		THEN( "the hash should match MurmurHash3_x64_128" ) {
+			auto hello = utilities::contentHash("hello");
+			REQUIRE( hello.low == 0xcbd8a7b341bd9b02ull );
+			REQUIRE( hello.high == 0x5b1e906a48ae1d19ull );
+
+			auto fox = utilities::contentHash("The quick brown fox jumps over the lazy dog");
+			REQUIRE( fox.low == 0xe34bbc7bbc071b6cull );
+			REQUIRE( fox.high == 0x7a433ca9c49a9347ull );
+		}
+	}
+
+	GIVEN( "No data" ) {
+		THEN( "the hash should be zero" ) {
+			auto empty = utilities::contentHash(nullptr, 0);
+			REQUIRE( empty.low == 0 );
+			REQUIRE( empty.high == 0 );
+		}
+	}
+
+	GIVEN( "Every tail length" ) {
+		const std::string data = "0123456789abcdefghijklmnopqrstuv";
+
+		THEN( "each prefix should hash differently" ) {
+			std::unordered_set<utilities::ContentHash> hashes;
+			for (size_t i = 0; i <= data.length(); i++)
+				hashes.insert(utilities::contentHash(data.data(), i));
+			REQUIRE( hashes.size() == data.length() + 1 );
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <string>
+#include <Crc32.h>
+
+SCENARIO( "Crc32", "[checksum]" ) {
+	GIVEN( "The standard check string" ) {
+		const std::string check = "123456789";
+
+		THEN( "the checksum should match CRC-32/ISO-HDLC" ) {
+			REQUIRE( utilities::crc32(check.data(), check.length()) == 0xCBF43926 );
+		}
+
+		THEN( "a checksum can be continued across calls" ) {
+			uint32_t crc = utilities::crc32(check.data(), 4);
+			REQUIRE( utilities::crc32(check.data() + 4, check.length() - 4, crc) == 0xCBF43926 );
+		}
+	}
+
+	GIVEN( "Data that isn't a multiple of eight bytes" ) {
+		const std::string data = "The quick brown fox jumps over the lazy dog";
+
+		THEN( "the trailing bytes should be included" ) {
+			REQUIRE( utilities::crc32(data.data(), data.length()) == 0x414FA339 );
+		}
+	}
+
+	GIVEN( "No data" ) {
+		THEN( "the checksum should be zero" ) {
+			REQUIRE( utilities::crc32(nullptr, 0) == 0 );
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <LatencyHistogram.h>
+#include <ScriptProfile.h>
+
+SCENARIO( "LatencyHistogram", "[profiling]" ) {
+	GIVEN( "Bucket boundaries" ) {
+		THEN( "every duration should fall inside its bucket" ) {
+			for (uint64_t micros : { 0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 100ull, 1000ull, 123456ull, (1ull << 25) - 1 })
+			{
+				size_t index = LatencyHistogram::bucketIndex(micros);
+				REQUIRE( index < LatencyHistogram::BUCKETS );
+				REQUIRE( LatencyHistogram::bucketUpperBound(index) >= micros );
+				if (index > 0)
+					REQUIRE( LatencyHistogram::bucketUpperBound(index - 1) < micros );
+			}
+		}
+
+		THEN( "durations past the range should share the last bucket" ) {
+			REQUIRE( LatencyHistogram::bucketIndex(1ull << 40) == LatencyHistogram::BUCKETS - 1 );
+		}
+	}
+
+	GIVEN( "A histogram of 1 to 1000 microseconds" ) {
+		LatencyHistogram histogram;
+		for (uint64_t i = 1; i <= 1000; i++)
+			histogram.record(i);
+
+		THEN( "percentiles should be within the bucket precision" ) {
+			REQUIRE( histogram.count() == 1000 );
+			REQUIRE( histogram.max() == 1000 );
+			REQUIRE( histogram.percentile(50.0) >= 500 );
+			REQUIRE( histogram.percentile(50.0) <= 500 * 9 / 8 );
+			REQUIRE( histogram.percentile(99.0) >= 990 );
+			REQUIRE( histogram.percentile(100.0) == 1000 );
+		}
+
+		THEN( "merging should add the counts" ) {
+			LatencyHistogram other;
+			other.record(5000);
+			histogram.merge(other);
+			REQUIRE( histogram.count() == 1001 );
+			REQUIRE( histogram.max() == 5000 );
+		}
+	}
+}
+
+SCENARIO( "ScriptProfile", "[profiling]" ) {
+	GIVEN( "Samples spread over two minutes" ) {
+		using namespace std::chrono_literals;
+
+		ScriptProfile profile;
+		ScriptProfile::time_point start{ std::chrono::seconds(600) };
+		for (int second = 0; second < 120; second++)
+			profile.addSample(start + std::chrono::seconds(second), 1ms);
+
+		THEN( "only the last minute should be counted" ) {
+			auto stats = profile.getStats(start + 119s);
+			REQUIRE( stats.calls == 60 );
+			REQUIRE( stats.callsPerSecond == 1.0 );
+			REQUIRE( stats.max == 0.001 );
+		}
+
+		THEN( "nothing should be left a minute after the last sample" ) {
+			REQUIRE( profile.getStats(start + 180s).calls == 0 );
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <RingBuffer.h>
+
+SCENARIO( "RingBuffer", "[buffer]" ) {
+	GIVEN( "An empty RingBuffer" ) {
+		RingBuffer buffer(8);
+
+		THEN( "it should be empty" ) {
+			REQUIRE( buffer.empty() );
+			REQUIRE( buffer.length() == 0 );
+			REQUIRE( buffer.peekShort() == 0 );
+		}
+
+		WHEN( "writing two frames" ) {
+			const char frames[] = { 0, 2, 'h', 'i', 0, 3, 'y', 'o', 'u' };
+			buffer.write(frames, sizeof(frames));
+
+			THEN( "the buffer should grow to fit" ) {
+				REQUIRE( buffer.length() == sizeof(frames) );
+				REQUIRE( buffer.capacity() >= sizeof(frames) );
+			}
+
+			THEN( "frames can be read in order" ) {
+				REQUIRE( buffer.peekShort() == 2 );
+				REQUIRE( buffer.view(2, 2) == "hi" );
+				buffer.consume(4);
+
+				REQUIRE( buffer.peekShort() == 3 );
+				REQUIRE( buffer.view(2, 3) == "you" );
+				buffer.consume(5);
+
+				REQUIRE( buffer.empty() );
+			}
+		}
+
+		WHEN( "writing past the end after consuming" ) {
+			buffer.write("abcdef", 6);
+			buffer.consume(4);
+			buffer.write("ghijkl", 6);
+
+			THEN( "unread data is compacted without growing" ) {
+				REQUIRE( buffer.capacity() == 8 );
+				REQUIRE( buffer.view() == "efghijkl" );
+			}
+		}
+
+		WHEN( "consuming more than is available" ) {
+			buffer.write("abc", 3);
+			buffer.consume(10);
+
+			THEN( "the buffer should be empty" ) {
+				REQUIRE( buffer.empty() );
+			}
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <string>
+#include <ScriptPreprocessor.h>
+
+SCENARIO( "ScriptPreprocessor", "[scripting]" ) {
+	GIVEN( "Public function declarations" ) {
+		const std::string code = "public function onCreated() {}\npublic\n  function   onTouch (a) {}\nfunction local() {}";
+
+		THEN( "the keyword should be removed and the names returned in order" ) {
+			std::string out;
+			auto names = stripPublicFunctions(code, out);
+
+			REQUIRE( names.size() == 2 );
+			REQUIRE( names[0] == "onCreated" );
+			REQUIRE( names[1] == "onTouch" );
+			REQUIRE( out == " function onCreated() {}\n\n  function   onTouch (a) {}\nfunction local() {}" );
+		}
+
+		THEN( "the script should be appended to the output" ) {
+			std::string out = "prefix;";
+			stripPublicFunctions(code, out);
+			REQUIRE( out.rfind("prefix; function onCreated()", 0) == 0 );
+		}
+	}
+
+	GIVEN( "Declarations inside strings, comments and regular expressions" ) {
+		const std::string code =
+			"var a = \"public function s1() {\";\n"
+			"var b = 'it\\'s public function s2(';\n"
+			"var c = `public function s3(`;\n"
+			"// public function s4()\n"
+			"/* public function s5() */\n"
+			"var d = /public function s6\\(/g;\n"
+			"var e = x / 2; public function real() {}\n";
+
+		THEN( "only the real declaration should be touched" ) {
+			std::string out;
+			auto names = stripPublicFunctions(code, out);
+
+			REQUIRE( names.size() == 1 );
+			REQUIRE( names[0] == "real" );
+			REQUIRE( out.find("public function s1") != std::string::npos );
+			REQUIRE( out.find("public function s6") != std::string::npos );
+			REQUIRE( out.find("public function real") == std::string::npos );
+		}
+	}
+
+	GIVEN( "Slashes and backticks that don't start a regular expression or end a string" ) {
+		THEN( "a slash after a postfix increment should be a division" ) {
+			std::string out;
+			auto names = stripPublicFunctions("x = a++ / 2; public function f() {}", out);
+			REQUIRE( names.size() == 1 );
+			REQUIRE( names[0] == "f" );
+		}
+
+		THEN( "a backtick inside a template substitution should not end the template" ) {
+			std::string out;
+			auto names = stripPublicFunctions("var s = `a ${\"`\"} b`; public function g() {}", out);
+			REQUIRE( names.size() == 1 );
+			REQUIRE( names[0] == "g" );
+		}
+
+		THEN( "braces inside a template substitution should not end it" ) {
+			std::string out;
+			auto names = stripPublicFunctions("var s = `${ {a: 1}.a } public function h() {}`; public function i() {}", out);
+			REQUIRE( names.size() == 1 );
+			REQUIRE( names[0] == "i" );
+		}
+	}
+
+	GIVEN( "Text that only looks like a declaration" ) {
+		THEN( "it should be left alone" ) {
+			for (const std::string code : { "mypublic function f() {}", "obj.public function f() {}",
+				"public functionf() {}", "public function f {}", "public function () {}" })
+			{
+				std::string out;
+				REQUIRE( stripPublicFunctions(code, out).empty() );
+				REQUIRE( out == code );
+			}
+		}
+	}
+
+	GIVEN( "No public functions" ) {
+		THEN( "there should be no exports" ) {
+			REQUIRE( getPublicFunctionExports({}).empty() );
+		}
+	}
+}
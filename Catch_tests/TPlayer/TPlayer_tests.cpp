@@ -1,5 +1,10 @@
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch_all.hpp"
+#include <filesystem>
+#include <fstream>
+#include <CFileSystem.h>
+#include <TLevel.h>
+#include <TMap.h>
 #include <TPlayer.h>
 #include <TServer.h>
 
@@ -23,4 +28,56 @@ SCENARIO( "TPlayer", "[object]" ) {
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+SCENARIO( "TPlayer map groups", "[object]" ) {
+
+	GIVEN( "A player on a group map" ) {
+		auto* server = new TServer("test");
+
+		// A 2x2 gmap, added to the level file system the same way the folder scan would.
+		std::filesystem::path gmapPath = std::filesystem::path(server->getServerPath().text()) / "world" / "grouptest.gmap";
+		std::filesystem::create_directories(gmapPath.parent_path());
+		{
+			std::ofstream gmap(gmapPath);
+			gmap << "GRMAP001\nWIDTH 2\nHEIGHT 2\nLEVELNAMES\n\"grouptest_a.nw\",\"grouptest_b.nw\"\n\"grouptest_c.nw\",\"grouptest_d.nw\"\nLEVELNAMESEND\n";
+		}
+		server->getFileSystem(FS_LEVEL)->addFile(gmapPath.string().c_str());
+
+		auto map = std::make_shared<TMap>(MapType::GMAP, true);
+		REQUIRE( map->load("grouptest.gmap", server) );
+
+		auto level = TLevel::createLevel(server, 511, "grouptest_d.nw");
+		level->setMap(map, 1, 1);
+
+		auto* player = new TPlayer(server, new CSocket(), 123);
+		REQUIRE( player->warp("grouptest_d.nw", 30.0f, 30.0f) );
+
+		auto playersNear = [&](const std::string& group) {
+			std::vector<uint16_t> ids;
+			map->forEachPlayerNear(1, 1, &group, [&](uint16_t id) { ids.push_back(id); });
+			return ids;
+		};
+
+		WHEN( "the player switches groups" ) {
+			player->setGroup("red");
+
+			THEN( "the player should only be in the new group's cell" ) {
+				REQUIRE( playersNear("").empty() );
+				REQUIRE( playersNear("red").size() == 1 );
+				REQUIRE( playersNear("red")[0] == 123 );
+			}
+
+			AND_WHEN( "the player switches again" ) {
+				player->setGroup("blue");
+
+				THEN( "the old group's cell should be empty" ) {
+					REQUIRE( playersNear("red").empty() );
+					REQUIRE( playersNear("blue").size() == 1 );
+				}
+			}
+		}
+
+		std::filesystem::remove(gmapPath);
+	}
+}
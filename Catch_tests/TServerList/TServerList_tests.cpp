@@ -0,0 +1,112 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <TServer.h>
+#include <TServerList.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// Listening socket on a free local port, standing in for the listserver.
+	int listenLocal(int& port)
+	{
+		int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		::bind(fd, (sockaddr *)&addr, sizeof(addr));
+		::listen(fd, 1);
+
+		socklen_t length = sizeof(addr);
+		::getsockname(fd, (sockaddr *)&addr, &length);
+		port = ntohs(addr.sin_port);
+		return fd;
+	}
+
+	// Run passes of the main loop's socket update until the condition holds or time is up.
+	// Returns the longest a single pass took.
+	template<typename Func>
+	std::chrono::nanoseconds runUntil(TServer *server, std::chrono::milliseconds limit, Func done)
+	{
+		std::chrono::nanoseconds longest{};
+		auto deadline = std::chrono::steady_clock::now() + limit;
+		while (!done() && std::chrono::steady_clock::now() < deadline)
+		{
+			auto start = std::chrono::steady_clock::now();
+			server->getSocketManager().update(0, 10000);
+			longest = std::max<std::chrono::nanoseconds>(longest, std::chrono::steady_clock::now() - start);
+		}
+		return longest;
+	}
+}
+
+SCENARIO( "TServerList", "[network]" ) {
+
+	GIVEN( "A listserver on a local port" ) {
+		int port = 0;
+		int listener = listenLocal(port);
+
+		auto* server = new TServer("test");
+		server->getSettings().addKey("listip", "127.0.0.1");
+		server->getSettings().addKey("listport", CString(port));
+		auto& serverList = server->getServerList();
+
+		WHEN( "connecting" ) {
+			auto start = std::chrono::steady_clock::now();
+			REQUIRE( serverList.connectServer() );
+			auto connectTime = std::chrono::steady_clock::now() - start;
+
+			THEN( "the main loop should not wait for it, and the handshake should be sent once it connects" ) {
+				REQUIRE( connectTime < 100ms );
+
+				// Only the socket manager runs, so the connect has to wake it up by itself.
+				runUntil(server, 2000ms, [&]() { return serverList.getConnected(); });
+				REQUIRE( serverList.getConnected() );
+
+				pollfd pfd{ listener, POLLIN, 0 };
+				REQUIRE( ::poll(&pfd, 1, 2000) == 1 );
+				int client = ::accept(listener, nullptr, nullptr);
+				REQUIRE( client >= 0 );
+
+				pfd = pollfd{ client, POLLIN, 0 };
+				REQUIRE( ::poll(&pfd, 1, 2000) == 1 );
+				char handshake[64];
+				REQUIRE( ::recv(client, handshake, sizeof(handshake), 0) > 0 );
+				::close(client);
+			}
+		}
+
+		serverList.disconnect();
+		::close(listener);
+	}
+
+	GIVEN( "A listserver address that doesn't answer" ) {
+		auto* server = new TServer("test");
+		server->getSettings().addKey("listip", "10.255.255.1");
+		server->getSettings().addKey("listport", "14922");
+		auto& serverList = server->getServerList();
+
+		WHEN( "connecting" ) {
+			auto start = std::chrono::steady_clock::now();
+			REQUIRE( serverList.connectServer() );
+			auto connectTime = std::chrono::steady_clock::now() - start;
+
+			THEN( "the main loop should keep running while the connect waits" ) {
+				REQUIRE( connectTime < 100ms );
+
+				auto longestPass = runUntil(server, 500ms, []() { return false; });
+				REQUIRE( longestPass < 100ms );
+				REQUIRE( !serverList.getConnected() );
+			}
+		}
+
+		serverList.disconnect();
+	}
+}
@@ -0,0 +1,79 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <vector>
+#include <TimerWheel.h>
+
+SCENARIO( "TimerWheel", "[timer]" ) {
+	GIVEN( "An empty TimerWheel" ) {
+		TimerWheel<int> wheel;
+		std::vector<std::pair<uint64_t, int>> fired;
+		auto fire = [&](uint64_t, int&& value) { fired.emplace_back(wheel.getTick(), value); };
+
+		THEN( "it should be empty" ) {
+			REQUIRE( wheel.empty() );
+			REQUIRE( wheel.nextExpiry() == 0 );
+		}
+
+		WHEN( "adding timers on every level" ) {
+			const uint64_t delays[] = { 1, 5, 255, 256, 300, 20000, 1000000 };
+			for (auto delay : delays)
+				wheel.add(delay, (int)delay);
+
+			for (uint64_t i = 0; i < 1000000; ++i)
+				wheel.advance(fire);
+
+			THEN( "each fires on the tick it expires" ) {
+				REQUIRE( fired.size() == std::size(delays) );
+				for (size_t i = 0; i < fired.size(); ++i)
+				{
+					REQUIRE( fired[i].first == delays[i] );
+					REQUIRE( fired[i].second == (int)delays[i] );
+				}
+				REQUIRE( wheel.empty() );
+			}
+		}
+
+		WHEN( "cancelling a timer" ) {
+			auto id = wheel.add(10, 1);
+			wheel.add(20, 2);
+
+			REQUIRE( wheel.remaining(id) == 10 );
+			REQUIRE( wheel.cancel(id) );
+			REQUIRE_FALSE( wheel.cancel(id) );
+
+			for (int i = 0; i < 20; ++i)
+				wheel.advance(fire);
+
+			THEN( "it never fires" ) {
+				REQUIRE( fired.size() == 1 );
+				REQUIRE( fired[0].second == 2 );
+			}
+		}
+
+		WHEN( "adding a timer while firing another" ) {
+			wheel.add(3, 1);
+			for (int i = 0; i < 10; ++i)
+			{
+				wheel.advance([&](uint64_t id, int&& value) {
+					if (value == 1)
+						wheel.add(4, 2);
+					fire(id, std::move(value));
+				});
+			}
+
+			THEN( "it fires relative to the current tick" ) {
+				REQUIRE( fired.size() == 2 );
+				REQUIRE( fired[1].first == 7 );
+			}
+		}
+
+		WHEN( "a timer is far out" ) {
+			wheel.add(1000, 1);
+
+			THEN( "the next expiry is never later than the timer" ) {
+				REQUIRE( wheel.nextExpiry() >= 1 );
+				REQUIRE( wheel.nextExpiry() <= 256 );
+			}
+		}
+	}
+}
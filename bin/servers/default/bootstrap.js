@@ -286,6 +286,14 @@
 			return server.httppost(...args);
 		};
 
+		env.global.httpgetsync = function(...args) {
+			return server.httpgetsync(...args);
+		};
+
+		env.global.httppostsync = function(...args) {
+			return server.httppostsync(...args);
+		};
+
 		env.global.findlevel = function(...args) {
 			return server.findlevel(...args);
 		};
@@ -0,0 +1,52 @@
+# Generates the table of native callbacks that a v8 startup snapshot refers to.
+# Every function in the binding sources that takes a v8 callback info is listed, always in
+# the same order, so the snapshot builder and the server agree on the reference indices.
+# A checksum of the binding sources is generated as well, so a snapshot built from other
+# bindings is rejected even if the callbacks didn't change.
+# Parameters:
+#   SOURCE_DIR  - Directory holding the V8*Impl.cpp binding sources.
+#   OUTPUT_FILE - Source file to generate.
+
+file(GLOB BINDING_SOURCES "${SOURCE_DIR}/V8*Impl.cpp")
+list(SORT BINDING_SOURCES)
+
+set(DECLARATIONS "")
+set(REFERENCES "")
+set(SOURCE_HASHES "")
+foreach(BINDING_SOURCE ${BINDING_SOURCES})
+	file(SHA256 ${BINDING_SOURCE} SOURCE_HASH)
+	string(APPEND SOURCE_HASHES "${SOURCE_HASH}")
+
+	file(STRINGS ${BINDING_SOURCE} CALLBACKS REGEX "^void [A-Za-z0-9_]+\\([^)]*CallbackInfo[^)]*\\)")
+	foreach(CALLBACK ${CALLBACKS})
+		string(REGEX MATCH "^void ([A-Za-z0-9_]+)(\\([^)]*\\))" DECLARATION "${CALLBACK}")
+		string(APPEND DECLARATIONS "void ${CMAKE_MATCH_1}${CMAKE_MATCH_2};\n")
+		string(APPEND REFERENCES "\t\treinterpret_cast<intptr_t>(&${CMAKE_MATCH_1}),\n")
+	endforeach()
+endforeach()
+
+string(SHA256 BINDINGS_HASH "${SOURCE_HASHES}")
+string(SUBSTRING "${BINDINGS_HASH}" 0 8 BINDINGS_CHECKSUM)
+
+file(WRITE "${OUTPUT_FILE}.tmp"
+"// Generated from the script bindings by cmake/generate_v8_references.cmake, do not edit.
+#include <cstdint>
+#include <vector>
+#include <v8.h>
+
+${DECLARATIONS}
+std::vector<intptr_t> getV8CallbackReferences()
+{
+	return {
+${REFERENCES}	};
+}
+
+uint32_t getV8BindingsChecksum()
+{
+	return 0x${BINDINGS_CHECKSUM};
+}
+")
+
+# Only touch the output when it changed, so the server isn't rebuilt for nothing.
+configure_file("${OUTPUT_FILE}.tmp" "${OUTPUT_FILE}" COPYONLY)
+file(REMOVE "${OUTPUT_FILE}.tmp")
@@ -1,10 +1,16 @@
 #ifndef CFILESYSTEM_H
 #define CFILESYSTEM_H
 
+#include <future>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "CString.h"
 
+class FileSystemWatcher;
 class TServer;
 class CFileSystem
 {
@@ -23,12 +29,37 @@ class CFileSystem
 		void clear();
 
 		void setServer(TServer* pServer) { server = pServer; }
+		void setWatcher(FileSystemWatcher* pWatcher) { watcher = pWatcher; }
 
 		void addDir(const CString& dir, const CString& wildcard = "*", bool forceRecursive = false);
 		void removeDir(const CString& dir);
+
+		//! Add a directory that was created inside a recursive directory, along with its sub-directories.
+		//! Unlike addDir() it isn't kept as a base directory, a rescan finds it again on its own.
+		//! \param dir full path of the directory, ending with the path separator
+		void addSubDir(const CString& dir);
+
+		//! Drop a directory that was deleted or moved out of a recursive directory, with everything below it
+		//! \param dir full path of the directory, ending with the path separator
+		void removeSubDir(const CString& dir);
 		void addFile(CString file);
 		void removeFile(const CString& file);
-		void resync();
+
+		//! Rescan every directory
+		//! \param background scan on a worker thread, the current file list stays in use until finishRebuild()
+		void resync(bool background = false);
+
+		//! Queue a directory for the next rebuild()
+		void queueDir(const CString& dir, const CString& wildcard = "*", bool forceRecursive = false);
+
+		//! Replace the directories with the queued ones, scanning them on a worker thread.
+		//! The current file list stays in use until finishRebuild()
+		void rebuild();
+
+		//! Swap in the file list from a background scan
+		//! \param wait block until the scan is done
+		//! \return true if a new file list was swapped in
+		bool finishRebuild(bool wait = false);
 
 		CString find(const CString& file) const;
 		CString findi(const CString& file) const;
@@ -37,7 +68,7 @@ class CFileSystem
 		time_t getModTime(const CString& file) const;
 		bool setModTime(const CString& file, time_t modTime) const;
 		int getFileSize(const CString& file) const;
-		std::map<CString, CString>& getFileList()	{ return fileList; }
+		std::map<CString, CString>& getFileList()	{ return index.fileList; }
 		std::vector<CString>* getDirList()			{ return &directoryList; }
 		CString getDirByExtension(const std::string& extension) const;
 
@@ -47,12 +78,63 @@ class CFileSystem
 		static void fixPathSeparators(CString& pPath);
 
 	private:
+		// Names that only differ by case share a folded entry, which points to the
+		// first of them in fileList order.
+		struct FoldedName
+		{
+			CString name;
+			int count;
+		};
+
+		struct FileIndex
+		{
+			void add(const CString& filename, const CString& path);
+			void remove(const CString& filename);
+			void clear();
+
+			std::map<CString, CString> fileList;
+			std::unordered_map<std::string, FoldedName> foldedList;
+		};
+
+		struct DirectorySpec
+		{
+			CString path;
+			bool recursive;
+		};
+
+		// Result of a full scan, built without touching the live file list.
+		struct ScanResult
+		{
+			FileIndex index;
+			std::vector<DirectorySpec> directories;
+		};
+
+		static void scanDirectory(const CString& directory, bool recursive, FileIndex& pIndex, std::vector<CString>& subDirs);
+		static std::unique_ptr<ScanResult> scanDirectories(std::vector<DirectorySpec> dirs);
+
 		void loadAllDirectories(const CString& directory, bool recursive = false);
+		void applyScan(std::unique_ptr<ScanResult> result);
+		void cancelRebuild();
+		DirectorySpec makeDirectorySpec(const CString& dir, const CString& wildcard, bool forceRecursive) const;
 
 		TServer* server;
+		FileSystemWatcher* watcher;
 		CString basedir;
-		std::map<CString, CString> fileList;
+		FileIndex index;
 		std::vector<CString> directoryList;
+
+		// Directories that were added directly, sub-directories are found again on a rescan.
+		std::vector<DirectorySpec> baseDirs, queuedDirs;
+
+		// Changes made while a background scan runs, replayed on the new file list.
+		struct PendingChange
+		{
+			CString filename;
+			CString path;
+			bool added;
+		};
+		std::future<std::unique_ptr<ScanResult>> pendingScan;
+		std::vector<PendingChange> pendingChanges;
 };
 
 inline void CFileSystem::fixPathSeparators(CString& pPath)
@@ -0,0 +1,185 @@
+#ifndef CPACKETQUEUE_H
+#define CPACKETQUEUE_H
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "CEncryption.h"
+#include "CSocket.h"
+#include "CString.h"
+#include "RingBuffer.h"
+
+//! Immutable packet that can be queued to any number of players without copying.
+using SharedPacket = std::shared_ptr<const CString>;
+
+//! Build a shared packet once so it can be queued by reference.
+//! \param pPacket packet data
+//! \param appendNL terminate the packet with a newline if it isn't already
+//! \return nullptr if the packet is empty
+SharedPacket makeSharedPacket(CString pPacket, bool appendNL = true);
+
+//! Produces file lane packets on demand, so a large file doesn't have to be split
+//! into packets and queued all at once.
+class PacketStream
+{
+	public:
+		virtual ~PacketStream() = default;
+
+		//! Get the next packets to send. A raw data header and its payload have to be returned together.
+		//! \param pPackets packets are appended to this
+		//! \return false once the stream has nothing left
+		virtual bool next(std::vector<SharedPacket>& pPackets) = 0;
+};
+
+//! File lane frame that was compressed ahead of time, so a file that a lot of players
+//! download is only compressed once. Both encodings are kept since the queue picks the
+//! compression by its encryption generation.
+struct PrecompressedFrame
+{
+	int length;		// uncompressed length
+	CString zlib;
+	CString bz2;
+};
+
+//! Compressed frame data for broadcast packets, shared between every queue that sends
+//! the same packets in a tick. Only the per-client encryption is left to each queue.
+class BroadcastFrameCache
+{
+	public:
+		//! Find the compressed data for a sequence of packets
+		//! \param pGen encryption generation the data was compressed for
+		//! \param pPackets packets in the frame, compared by identity
+		//! \param pCompressionType set to the compression used
+		//! \return compressed data, or nullptr if it isn't cached
+		const CString* find(int pGen, const std::vector<SharedPacket>& pPackets, int& pCompressionType) const;
+
+		void add(int pGen, std::vector<SharedPacket> pPackets, const CString& pData, int pCompressionType);
+
+		//! Called once a tick, the same packets won't be sent again after that
+		void clear()		{ frames.clear(); }
+
+	private:
+		struct CachedFrame
+		{
+			int gen;
+			int compressionType;
+			std::vector<SharedPacket> packets;
+			CString data;
+		};
+
+		static size_t hashPackets(int pGen, const std::vector<SharedPacket>& pPackets);
+
+		std::unordered_multimap<size_t, CachedFrame> frames;
+};
+
+//! Send limits shared by every player queue, set from the server options.
+struct OutboundLimits
+{
+	using clock = std::chrono::high_resolution_clock;
+
+	//! Length of a send tick.
+	std::chrono::milliseconds tick{ 50 };
+
+	//! Bytes of packet data a connection can send per tick, or 0 for no limit.
+	//! Gameplay packets always go out, file transfers only get what they leave.
+	int bytesPerTick = 0;
+
+	//! Bytes of each tick's budget that gameplay packets can't use up, so file transfers keep moving.
+	int fileBytesPerTick = 0;
+
+	//! Gameplay packets are held and sent together at most this often, or at the end of
+	//! every main loop pass if 0.
+	std::chrono::milliseconds flushInterval{ 0 };
+
+	//! Set when a queue is holding packets for the next flush.
+	bool flushPending = false;
+};
+
+//! Outgoing packet queue for a player socket.
+//! Replaces CFileQueue for players so packets can be queued by reference. Packets are
+//! only copied once, when they are combined into a frame to be compressed and encrypted.
+//! Gameplay packets are sent in the order they were queued, ahead of file data, which is
+//! throttled by the OutboundLimits. Queues with limits hold their gameplay packets until
+//! release(), so everything queued in a tick goes out in one frame.
+class CPacketQueue
+{
+	public:
+		explicit CPacketQueue(CSocket* pSocket);
+
+		void setSocket(CSocket* pSocket)	{ sock = pSocket; }
+		void setFrameCache(BroadcastFrameCache* pCache)	{ frameCache = pCache; }
+		void setLimits(OutboundLimits* pLimits);
+		void setCodec(int pGen, int pKey);
+
+		void addPacket(CString pPacket);
+		void addPacket(const SharedPacket& pPacket, bool pBroadcast = false);
+
+		//! Queue a stream on the file lane, its packets are only built when they are about to be sent
+		void addStream(std::unique_ptr<PacketStream> pStream);
+
+		//! Let the gameplay packets queued so far be sent
+		void release()		{ released = true; }
+
+		//! Queue a precompressed frame on the file lane, it is sent on its own without being compressed again
+		void addFrame(std::shared_ptr<const PrecompressedFrame> pFrame);
+
+		bool canSend() const;
+
+		//! Earliest time file data held back by the budget can be sent
+		//! \return time_point::max() if no file data is waiting on the budget
+		OutboundLimits::clock::time_point nextSendTime() const;
+
+		void sendCompress();
+		void clearBuffers();
+
+	private:
+		struct QueuedPacket
+		{
+			SharedPacket data;
+			bool broadcast;
+		};
+
+		// Either a packet, a precompressed frame or a stream that still has packets to give.
+		struct QueuedFilePacket
+		{
+			SharedPacket data;
+			std::unique_ptr<PacketStream> stream;
+			std::shared_ptr<const PrecompressedFrame> frame;
+		};
+
+		bool canSendGameplay() const;
+		bool canSendFile() const;
+		void refillBudget();
+		void spendBudget(int pBytes, bool pFile);
+		bool takeNormalPackets(std::deque<QueuedPacket>& pBuffer, std::vector<SharedPacket>& pFrame, int& pFrameLength, bool& pBroadcastOnly);
+		bool expandFileStream();
+		std::shared_ptr<const PrecompressedFrame> takePrecompressedFrame();
+		int selectFrameData(const PrecompressedFrame& pFrame, CString& pSend) const;
+		bool addFileChunk(std::vector<SharedPacket>& pFrame, int& pFrameLength);
+		std::vector<SharedPacket> takeFramePackets(bool& pBroadcastOnly, int& pGameplayLength, int& pFileLength);
+		int compressFrame(CString& pSend);
+		void appendFrame(CString& pSend, int pCompressionType);
+		void flush();
+
+		CSocket* sock;
+		CEncryption out_codec;
+		BroadcastFrameCache* frameCache;
+		OutboundLimits* limits;
+
+		// Files and raw data are kept apart so a download doesn't hold up gameplay packets.
+		std::deque<QueuedPacket> gameplayBuffer;
+		std::deque<QueuedFilePacket> fileBuffer;
+		bool rawPending;
+		bool fileDeferred;
+		bool released;
+
+		// Bytes left to send this tick, negative if a file chunk went over.
+		int budget;
+		OutboundLimits::clock::time_point tickStart;
+
+		RingBuffer oBuffer;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef GS2EMU_FILETRANSFER_H
+#define GS2EMU_FILETRANSFER_H
+
+#include <cstdint>
+#include <ctime>
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CPacketQueue.h"
+#include "CString.h"
+#include "FileCache.h"
+
+//! Size of the file chunks sent to clients that support large files.
+constexpr int FILE_CHUNK_SIZE = 32000;
+
+//! Splits a file into PLO_RAWDATA/PLO_FILE packets, one chunk at a time.
+class FileSendStream : public PacketStream
+{
+	public:
+		//! \param pFile file contents
+		//! \param pName file name the client gets
+		//! \param pPacketLength length of the PLO_FILE packet without the file data
+		//! \param pChunkSize maximum amount of file data in a packet
+		//! \param pSendModTime whether the client expects the modification time
+		FileSendStream(std::shared_ptr<const CachedFile> pFile, const CString& pName, int pPacketLength, int pChunkSize, bool pSendModTime);
+
+		bool next(std::vector<SharedPacket>& pPackets) override;
+
+	private:
+		std::shared_ptr<const CachedFile> file;
+		CString name;
+		int packetLength;
+		int chunkSize;
+		bool sendModTime;
+		int offset;
+};
+
+//! Every chunk of a file, compressed as file lane frames.
+struct PrecompressedFile
+{
+	uint32_t checksum;
+	long long size;
+	time_t modTime;
+	size_t bytes;
+	std::vector<PrecompressedFrame> frames;
+};
+
+//! Keeps compressed copies of the large files players download, so a file is compressed
+//! once instead of once per player. Files are compressed on a worker thread the first time
+//! they are requested and are replaced once their contents change.
+class PrecompressedFileStore
+{
+	public:
+		explicit PrecompressedFileStore(size_t pMaxBytes = 32 * 1024 * 1024, int pMinSize = 64 * 1024);
+
+		// Delete copy operations
+		PrecompressedFileStore(const PrecompressedFileStore&) = delete;
+		PrecompressedFileStore& operator=(const PrecompressedFileStore&) = delete;
+
+		//! Find the compressed frames of a file, starting to compress it if they don't exist yet
+		//! \param pName file name the client gets
+		//! \param pFile file contents
+		//! \param pChecksum checksum of the file contents
+		//! \return nullptr if the file is too small or its frames aren't ready yet
+		std::shared_ptr<const PrecompressedFile> find(const CString& pName, const std::shared_ptr<const CachedFile>& pFile, uint32_t pChecksum);
+
+		//! Keep the files that finished compressing
+		void update();
+
+		//! Set the byte budget, dropping files if the store is over it
+		void setMaxBytes(size_t pMaxBytes);
+
+		//! Files smaller than this are compressed with the rest of the packets as usual
+		void setMinSize(int pMinSize)	{ minSize = pMinSize; }
+
+		size_t getCachedBytes() const	{ return cachedBytes; }
+		void clear();
+
+	private:
+		struct Entry
+		{
+			std::string name;
+			std::shared_ptr<const PrecompressedFile> file;
+		};
+
+		static std::shared_ptr<const PrecompressedFile> build(std::shared_ptr<const CachedFile> pFile, CString pName, uint32_t pChecksum);
+
+		void erase(std::list<Entry>::iterator pEntry);
+		void evict();
+
+		// Most recently used first.
+		std::list<Entry> lru;
+		std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+		std::unordered_map<std::string, std::future<std::shared_ptr<const PrecompressedFile>>> builds;
+		size_t maxBytes;
+		size_t cachedBytes;
+		int minSize;
+};
+
+#endif
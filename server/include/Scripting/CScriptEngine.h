@@ -7,15 +7,23 @@
 #include <string>
 #include <atomic>
 #include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include "ContentHash.h"
 #include "ScriptBindings.h"
+#include "HttpRequestPool.h"
 #include "ScriptAction.h"
 #include "ScriptFactory.h"
+#include "ScriptProfile.h"
+#include "ScriptUtils.h"
 #include "SourceCode.h"
+#include "TimerWheel.h"
 
 #ifdef V8NPCSERVER
 #include "V8ScriptWrappers.h"
@@ -23,12 +31,26 @@
 
 class IScriptEnv;
 class IScriptFunction;
+struct V8Snapshot;
+class CString;
 
 class TNPC;
 class TServer;
 class TWeapon;
 
 
+//! Startup snapshot file, next to the server executable.
+constexpr const char *V8SNAPSHOT_FILE = "v8snapshot.bin";
+
+//! Order queued npc events run in when RunScripts() runs out of time, events triggered by
+//! players go before timers.
+enum class ScriptPriority : uint8_t
+{
+	Player,
+	Timer,
+	Count
+};
+
 class CScriptEngine
 {
 public:
@@ -39,6 +61,20 @@ public:
 	void Cleanup(bool shutDown = false);
 	void RunScripts(const std::chrono::high_resolution_clock::time_point& time);
 
+	//! Build a v8 startup snapshot of the bound classes and the compiled bootstrap script
+	//! \param path file to write the snapshot to
+	//! \return false if the snapshot couldn't be built or written
+	static bool BuildSnapshot(const std::string& path);
+
+	//! Earliest time RunScripts() has work to do, used to schedule the main loop wake-up
+	std::chrono::high_resolution_clock::time_point getNextRunTime() const;
+
+	//! Hand finished http requests back to the scripts that made them
+	void RunHttpRequests();
+
+	//! Execution times of the promise handlers run by RunHttpRequests()
+	const ScriptProfile& getHttpProfile() const;
+
 	void ScriptWatcher();
 	void StartScriptExecution(const std::chrono::high_resolution_clock::time_point& startTime);
 	bool StopScriptExecution();
@@ -46,18 +82,23 @@ public:
 	TServer * getServer() const;
 	IScriptEnv * getScriptEnv() const;
 	IScriptObject<TServer> * getServerObject() const;
+	HttpRequestPool * getHttpRequests() const;
 
 	bool ExecuteNpc(TNPC *npc);
 	bool ExecuteWeapon(TWeapon *weapon);
 
-	void RegisterNpcTimer(TNPC *npc);
-	void RegisterNpcUpdate(TNPC *npc);
+	void RegisterNpcUpdate(TNPC *npc, ScriptPriority priority = ScriptPriority::Player);
 	void RegisterWeaponUpdate(TWeapon *weapon);
 
-	void UnregisterNpcTimer(TNPC *npc);
 	void UnregisterNpcUpdate(TNPC *npc);
 	void UnregisterWeaponUpdate(TWeapon *weapon);
 
+	// npc timers, in 0.05 second ticks
+	uint64_t ScheduleNpcTimeout(TNPC *npc, unsigned int ticks);
+	uint64_t ScheduleNpcEvent(TNPC *npc, unsigned int ticks, ScriptAction action);
+	bool CancelTimer(uint64_t id);
+	unsigned int getTimerRemaining(uint64_t id) const;
+
 	// callbacks
 	IScriptFunction * getCallBack(const std::string& callback) const;
 	void removeCallBack(const std::string& callback);
@@ -76,6 +117,9 @@ public:
 	template<typename T>
 	bool ClearCache(const std::string_view& code);
 
+	//! Counters of the compiled script cache
+	const ScriptCacheStats& getCacheStats() const;
+
 	template<class... Args>
 	ScriptAction CreateAction(const std::string& action, Args... An);
 
@@ -88,12 +132,35 @@ public:
 	void reportScriptException(const std::string& error_message);
 
 private:
+	struct NpcTimer
+	{
+		TNPC *npc;
+		ScriptAction action;	// empty for npc.timeout
+	};
+
+	// The hash isn't cryptographic and scripts are user content, so the source is kept to
+	// compare against. Scripts that collide get their own entries under the same hash.
+	struct CachedScript
+	{
+		IScriptFunction *function;
+		std::string source;
+	};
+
+	using ScriptCache = std::unordered_multimap<utilities::ContentHash, CachedScript>;
+
 	void runTimers(const std::chrono::high_resolution_clock::time_point& time);
+	bool runNextUpdate(std::map<int, TNPC *>& deleteNpcs);
+	ScriptCache::iterator findCachedScript(const std::string& code);
+	void bindClasses();
+	std::vector<intptr_t> getExternalReferences() const;
+	std::unique_ptr<V8Snapshot> loadSnapshot(const CString& bootstrapScript) const;
 
 	IScriptEnv *_env;
 	IScriptFunction *_bootstrapFunction;
 	std::unique_ptr<IScriptObject<TServer>> _environmentObject;
 	std::unique_ptr<IScriptObject<TServer>> _serverObject;
+	std::unique_ptr<HttpRequestPool> _httpRequests;
+	ScriptProfile _httpProfile;
 	TServer *_server;
 
 	std::chrono::high_resolution_clock::time_point lastScriptTimer;
@@ -106,11 +173,15 @@ private:
 	std::mutex _scriptWatcherLock;
 	std::thread _scriptWatcherThread;
 
-	std::unordered_map<std::string, IScriptFunction *> _cachedScripts;
+	ScriptCache _cachedScripts;
+	ScriptCacheStats _cacheStats;
 	std::unordered_map<std::string, IScriptFunction *> _callbacks;
-	std::unordered_set<TNPC *> _updateNpcs;
-	std::unordered_set<TNPC *> _updateNpcsTimer;
+	std::unordered_map<TNPC *, ScriptPriority> _updateNpcs;
+	std::deque<TNPC *> _npcQueues[(size_t)ScriptPriority::Count];
+	TimerWheel<NpcTimer> _timers;
 	std::unordered_set<TWeapon *> _updateWeapons;
+	std::deque<TWeapon *> _weaponQueue;
+	std::chrono::nanoseconds _tickBudget;
 	std::unordered_set<IScriptFunction *> _deletedCallbacks;
 };
 
@@ -137,6 +208,10 @@ inline TServer * CScriptEngine::getServer() const {
 	return _server;
 }
 
+inline const ScriptProfile& CScriptEngine::getHttpProfile() const {
+	return _httpProfile;
+}
+
 inline IScriptEnv * CScriptEngine::getScriptEnv() const {
 	return _env;
 }
@@ -145,6 +220,10 @@ inline IScriptObject<TServer> * CScriptEngine::getServerObject() const {
 	return _serverObject.get();
 }
 
+inline HttpRequestPool * CScriptEngine::getHttpRequests() const {
+	return _httpRequests.get();
+}
+
 inline IScriptFunction * CScriptEngine::getCallBack(const std::string& callback) const {
 	auto it = _callbacks.find(callback);
 	if (it != _callbacks.end())
@@ -153,25 +232,32 @@ inline IScriptFunction * CScriptEngine::getCallBack(const std::string& callback)
 	return nullptr;
 }
 
+inline const ScriptCacheStats& CScriptEngine::getCacheStats() const {
+	return _cacheStats;
+}
+
 inline const ScriptRunError& CScriptEngine::getScriptError() const {
 	return _env->getScriptError();
 }
 
 // Register scripts for processing
 
-inline void CScriptEngine::RegisterNpcTimer(TNPC *npc) {
-	_updateNpcsTimer.insert(npc);
-}
-
-inline void CScriptEngine::RegisterNpcUpdate(TNPC *npc) {
-	_updateNpcs.insert(npc);
+inline void CScriptEngine::RegisterNpcUpdate(TNPC *npc, ScriptPriority priority) {
+	auto [it, inserted] = _updateNpcs.try_emplace(npc, priority);
+	if (inserted || priority < it->second)
+	{
+		// A promoted npc leaves its old queue entry behind, which is skipped.
+		it->second = priority;
+		_npcQueues[(size_t)priority].push_back(npc);
+	}
 }
 
 inline void CScriptEngine::RegisterWeaponUpdate(TWeapon *weapon) {
-	_updateWeapons.insert(weapon);
+	if (_updateWeapons.insert(weapon).second)
+		_weaponQueue.push_back(weapon);
 }
 
-// Unregister scripts from processing
+// Unregister scripts from processing, their queue entries are skipped
 
 inline void CScriptEngine::UnregisterWeaponUpdate(TWeapon *weapon) {
 	_updateWeapons.erase(weapon);
@@ -181,8 +267,22 @@ inline void CScriptEngine::UnregisterNpcUpdate(TNPC *npc) {
 	_updateNpcs.erase(npc);
 }
 
-inline void CScriptEngine::UnregisterNpcTimer(TNPC *npc) {
-	_updateNpcsTimer.erase(npc);
+// Timers
+
+inline uint64_t CScriptEngine::ScheduleNpcTimeout(TNPC *npc, unsigned int ticks) {
+	return _timers.add(ticks, NpcTimer{ npc, ScriptAction{} });
+}
+
+inline uint64_t CScriptEngine::ScheduleNpcEvent(TNPC *npc, unsigned int ticks, ScriptAction action) {
+	return _timers.add(ticks, NpcTimer{ npc, std::move(action) });
+}
+
+inline bool CScriptEngine::CancelTimer(uint64_t id) {
+	return _timers.cancel(id);
+}
+
+inline unsigned int CScriptEngine::getTimerRemaining(uint64_t id) const {
+	return (unsigned int)_timers.remaining(id);
 }
 
 //
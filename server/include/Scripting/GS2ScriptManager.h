@@ -3,17 +3,28 @@
 
 #pragma once
 
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
 
 #include "utils/ContextThreadPool.h"
 #include "CompilerThreadJob.h"
 #include "GS2Context.h"
+#include "ContentHash.h"
 #include "interface/ScriptUtils.h"
 
 class GS2ScriptManager
 {
-	using BytecodeCache = std::unordered_map<std::string, CompilerResponse>;
+	// The hash isn't cryptographic and scripts are user content, so the source is kept to
+	// compare against. Scripts that collide get their own entries under the same hash.
+	struct CachedBytecode
+	{
+		CompilerResponse response;
+		std::shared_ptr<const std::string> source;
+	};
+
+	using BytecodeCache = std::unordered_multimap<utilities::ContentHash, CachedBytecode>;
 	
 	// used for threadpool job queue
 	using CompilerThreadPool = CustomThreadPool<CallbackThreadJob>;
@@ -29,16 +40,23 @@ public:
 	void compileScript(const std::string& script, user_callback_type finishedCb);
 	void runQueue();
 
+	//! Counters of the bytecode cache
+	const ScriptCacheStats& getCacheStats() const { return _cacheStats; }
+
 private:
 	// Async Compile
-	void queueCompileJob(const std::string &script, user_callback_type& finishedCb);
+	void queueCompileJob(const std::string &script, const utilities::ContentHash& hash, user_callback_type& finishedCb);
 
 	// Sync Compile
 	GS2Context _context;
-	void syncCompileJob(const std::string& script, user_callback_type& finishedCb);
+	void syncCompileJob(const std::string& script, const utilities::ContentHash& hash, user_callback_type& finishedCb);
+
+	BytecodeCache::iterator findBytecode(const utilities::ContentHash& hash, const std::string& script);
+	const CompilerResponse& cacheBytecode(const utilities::ContentHash& hash, std::shared_ptr<const std::string> source, CompilerResponse&& response);
 	
 	//
 	BytecodeCache _bytecodeCache;
+	ScriptCacheStats _cacheStats;
 	CompilerThreadPool _compilerThreadPool;
 
 	std::queue<queue_item_type> _cbQueue;
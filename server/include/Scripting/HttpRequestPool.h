@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef HTTPREQUESTPOOL_H
+#define HTTPREQUESTPOOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "WakeupEvent.h"
+
+namespace httplib
+{
+	class Client;
+}
+
+struct HttpRequest
+{
+	std::string host;	// scheme and host, ie: https://example.com
+	std::string path;
+	std::string body;
+	std::string contentType;
+	bool post;
+};
+
+struct HttpResponse
+{
+	int status;
+	std::string body;
+	std::string error;	// empty if the request went through
+};
+
+//! Runs http requests for scripts on worker threads. Results are handed back through
+//! update(), which is called from the main loop, so callbacks never run on a worker.
+//! Connections are kept open and reused for later requests to the same host.
+//! The workers only share state through a shared pointer, so the pool can be destroyed
+//! without waiting for requests that are still running.
+class HttpRequestPool
+{
+public:
+	using Callback = std::function<void(const HttpResponse&)>;
+
+	//! \param pThreads number of requests that can run at the same time
+	//! \param pMaxInFlight maximum number of requests that can be waiting for a result
+	//! \param pTimeout connect, read and write timeout of each request
+	HttpRequestPool(size_t pThreads, size_t pMaxInFlight, std::chrono::seconds pTimeout);
+	~HttpRequestPool();
+
+	// Delete copy and move operations
+	HttpRequestPool(const HttpRequestPool&) = delete;
+	HttpRequestPool& operator=(const HttpRequestPool&) = delete;
+	HttpRequestPool(HttpRequestPool&&) = delete;
+	HttpRequestPool& operator=(HttpRequestPool&&) = delete;
+
+	//! Queue a request
+	//! \param pRequest request to send
+	//! \param pCallback called from update() with the result
+	//! \return false if too many requests are already waiting
+	bool request(HttpRequest pRequest, Callback pCallback);
+
+	//! Call the callbacks of finished requests
+	//! \return number of callbacks that were called
+	size_t update();
+
+	size_t getInFlight() const		{ return callbacks.size(); }
+
+	//! Socket for the main loop to register with its socket manager, it becomes readable
+	//! when a request finishes. nullptr if the platform has no eventfd.
+	CSocketStub * getWakeupSocket() const	{ return state->wakeup.isValid() ? &state->wakeup : nullptr; }
+
+private:
+	struct QueuedRequest
+	{
+		uint64_t id;
+		HttpRequest request;
+	};
+
+	struct FinishedRequest
+	{
+		uint64_t id;
+		HttpResponse response;
+	};
+
+	// Everything the workers use, which outlives the pool until the last worker exits.
+	struct SharedState
+	{
+		SharedState(size_t pThreads, std::chrono::seconds pTimeout);
+
+		size_t threadCount;
+		std::chrono::seconds timeout;
+		WakeupEvent wakeup;
+
+		std::mutex lock;
+		std::condition_variable queueCondition;
+		std::deque<QueuedRequest> queue;
+		std::vector<FinishedRequest> finished;
+		std::unordered_map<std::string, std::vector<std::unique_ptr<httplib::Client>>> idleClients;
+		bool running;
+	};
+
+	static void worker(std::shared_ptr<SharedState> pState);
+	static HttpResponse send(SharedState& pState, const HttpRequest& pRequest);
+	static std::unique_ptr<httplib::Client> acquireClient(SharedState& pState, const std::string& pHost);
+	static void releaseClient(SharedState& pState, const std::string& pHost, std::unique_ptr<httplib::Client> pClient);
+
+	size_t maxInFlight;
+
+	// Only used from the main thread.
+	uint64_t nextId;
+	std::unordered_map<uint64_t, Callback> callbacks;
+
+	std::shared_ptr<SharedState> state;
+};
+
+#endif
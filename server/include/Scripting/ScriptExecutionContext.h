@@ -3,10 +3,13 @@
 #ifndef SCRIPTEXECUTION_H
 #define SCRIPTEXECUTION_H
 
-#include <algorithm>
 #include <chrono>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "ScriptAction.h"
+#include "ScriptProfile.h"
 #include "ScriptUtils.h"
 #include "CScriptEngine.h"
 
@@ -19,18 +22,23 @@ public:
 	~ScriptExecutionContext() { resetExecution(); }
 
 	bool hasActions() const;
-	std::pair<unsigned int, double> getExecutionData();
+
+	//! Execution times of all events in the last minute
+	ScriptProfileStats getProfileStats() const;
+
+	//! Execution times of each event in the last minute
+	std::vector<std::pair<std::string, ScriptProfileStats>> getEventProfileStats() const;
 
 	void addAction(ScriptAction& action);
 	void addAction(ScriptAction&& action);
-	void addExecutionSample(const ScriptTimeSample& sample);
+	void addExecutionSample(const std::string& event, const ScriptProfile::time_point& time, std::chrono::nanoseconds duration);
 	void resetExecution();
 	bool runExecution();
 
 private:
 	CScriptEngine *_scriptEngine;
 	std::vector<ScriptAction> _actions;
-	std::vector<ScriptTimeSample> _scriptTimeSamples;
+	std::unordered_map<std::string, ScriptProfile> _eventProfiles;
 };
 
 inline bool ScriptExecutionContext::hasActions() const
@@ -38,52 +46,41 @@ inline bool ScriptExecutionContext::hasActions() const
 	return !_actions.empty();
 }
 
-inline void ScriptExecutionContext::addExecutionSample(const ScriptTimeSample& sample)
+inline void ScriptExecutionContext::addExecutionSample(const std::string& event, const ScriptProfile::time_point& time, std::chrono::nanoseconds duration)
 {
 #ifndef NOSCRIPTPROFILING
-	_scriptTimeSamples.push_back(sample);
-
-	// Remove any script samples over a minute old
-	//if (_scriptTimeSamples.size() > 1024)
-	{
-		auto curSampleTime = sample.sample_time;
-		while (!_scriptTimeSamples.empty())
-		{
-			auto oldSample = _scriptTimeSamples.begin();
-			auto sample_diff = std::chrono::duration_cast<std::chrono::minutes>(curSampleTime - oldSample->sample_time);
-			if (sample_diff.count() < 1)
-				break;
-
-			_scriptTimeSamples.erase(oldSample);
-		}
-	}
+	_eventProfiles[event].addSample(time, duration);
 #endif
 }
 
-inline std::pair<unsigned int, double> ScriptExecutionContext::getExecutionData()
+inline ScriptProfileStats ScriptExecutionContext::getProfileStats() const
 {
-	double exectime = 0.0;
-	unsigned int calls = 0;
+	LatencyHistogram histogram;
 
 #ifndef NOSCRIPTPROFILING
 	auto time_now = std::chrono::high_resolution_clock::now();
+	for (const auto& [event, profile] : _eventProfiles)
+		profile.mergeInto(histogram, time_now);
+#endif
 
-	for (auto it = _scriptTimeSamples.begin(); it != _scriptTimeSamples.end();)
-	{
-		auto sample_diff = std::chrono::duration_cast<std::chrono::minutes>(time_now - (*it).sample_time);
-		if (sample_diff.count() >= 1)
-		{
-			it = _scriptTimeSamples.erase(it);
-			continue;
-		}
+	return ScriptProfile::getStats(histogram);
+}
+
+inline std::vector<std::pair<std::string, ScriptProfileStats>> ScriptExecutionContext::getEventProfileStats() const
+{
+	std::vector<std::pair<std::string, ScriptProfileStats>> eventStats;
 
-		exectime += (*it).sample;
-		calls++;
-		++it;
+#ifndef NOSCRIPTPROFILING
+	auto time_now = std::chrono::high_resolution_clock::now();
+	for (const auto& [event, profile] : _eventProfiles)
+	{
+		auto stats = profile.getStats(time_now);
+		if (stats.calls > 0)
+			eventStats.emplace_back(event, stats);
 	}
 #endif
 
-	return { calls, exectime };
+	return eventStats;
 }
 
 inline void ScriptExecutionContext::addAction(ScriptAction& action)
@@ -103,10 +100,6 @@ inline void ScriptExecutionContext::addAction(ScriptAction&& action)
 inline void ScriptExecutionContext::resetExecution()
 {
 	_actions.clear();
-
-#ifndef NOSCRIPTPROFILING
-	//_scriptTimeSamples.clear();
-#endif
 }
 
 inline bool ScriptExecutionContext::runExecution()
@@ -121,6 +114,7 @@ inline bool ScriptExecutionContext::runExecution()
 
 	// iterate over queued actions
 	SCRIPTENV_D("Running %zd actions:\n", iterateActions.size());
+	auto actionTimer = currentTimer;
 	for (auto & action : iterateActions)
 	{
 		SCRIPTENV_D("Running action: %s\n", action.getAction().c_str());
@@ -128,6 +122,12 @@ inline bool ScriptExecutionContext::runExecution()
 		if (!res) {
 			_scriptEngine->reportScriptException(_scriptEngine->getScriptError());
 		}
+
+#ifndef NOSCRIPTPROFILING
+		auto endTimer = std::chrono::high_resolution_clock::now();
+		addExecutionSample(action.getAction(), endTimer, endTimer - actionTimer);
+		actionTimer = endTimer;
+#endif
 	}
 
 	if (!_scriptEngine->StopScriptExecution())
@@ -136,12 +136,6 @@ inline bool ScriptExecutionContext::runExecution()
 		printf("Oh no we were killed!!\n");
 	}
 
-#ifndef NOSCRIPTPROFILING
-	auto endTimer = std::chrono::high_resolution_clock::now();
-	auto time_diff = std::chrono::duration<double>(endTimer - currentTimer);
-	addExecutionSample({ time_diff.count(), endTimer });
-#endif
-
 	return hasActions();
 }
 
@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef SCRIPTPREPROCESSOR_H
+#define SCRIPTPREPROCESSOR_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Copy a script while removing the `public` keyword from `public function name(` declarations,
+//! which isn't valid javascript. Done in a single pass that skips strings, template literals,
+//! comments and regular expression literals, so only real declarations are touched. Line and
+//! column numbers of the rest of the script are kept.
+//! \param code script source
+//! \param out string the script is appended to
+//! \return names of the public functions, in the order they are declared
+std::vector<std::string> stripPublicFunctions(std::string_view code, std::string& out);
+
+//! Script that assigns the public functions to `self`, so other scripts can call them
+//! \param names names returned by stripPublicFunctions()
+//! \return script to append inside the wrapper, empty if there are no public functions
+std::string getPublicFunctionExports(const std::vector<std::string>& names);
+
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef SCRIPTPROFILE_H
+#define SCRIPTPROFILE_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "LatencyHistogram.h"
+
+//! Execution times of a script over the last minute, times are in seconds.
+struct ScriptProfileStats
+{
+	uint64_t calls = 0;
+	double callsPerSecond = 0.0;
+	double total = 0.0;
+	double p50 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+//! Execution times of a script over the last minute, kept in a ring of ten second slots that
+//! each hold a latency histogram. Adding a sample is constant time, and old samples are dropped
+//! by reusing their slot. Histograms are only allocated for slots that have samples.
+class ScriptProfile
+{
+public:
+	using time_point = std::chrono::high_resolution_clock::time_point;
+
+	static constexpr int64_t SLOT_SECONDS = 10;
+	static constexpr size_t SLOTS = 6;
+
+	void addSample(const time_point& time, std::chrono::nanoseconds duration);
+
+	//! Add the samples of the last minute to a histogram
+	void mergeInto(LatencyHistogram& histogram, const time_point& time) const;
+
+	//! Summarize a histogram of the last minute
+	static ScriptProfileStats getStats(const LatencyHistogram& histogram);
+
+	ScriptProfileStats getStats(const time_point& time) const;
+
+private:
+	struct Slot
+	{
+		int64_t id = -1;
+		std::unique_ptr<LatencyHistogram> histogram;
+	};
+
+	static int64_t getSlotId(const time_point& time);
+
+	std::array<Slot, SLOTS> _slots;
+};
+
+inline int64_t ScriptProfile::getSlotId(const time_point& time)
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count() / SLOT_SECONDS;
+}
+
+inline void ScriptProfile::addSample(const time_point& time, std::chrono::nanoseconds duration)
+{
+	int64_t id = getSlotId(time);
+	Slot& slot = _slots[id % SLOTS];
+	if (slot.id != id)
+	{
+		// Slot is from a previous minute, start it over.
+		slot.id = id;
+		if (slot.histogram)
+			slot.histogram->clear();
+	}
+
+	if (!slot.histogram)
+		slot.histogram = std::make_unique<LatencyHistogram>();
+
+	slot.histogram->record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+inline void ScriptProfile::mergeInto(LatencyHistogram& histogram, const time_point& time) const
+{
+	int64_t id = getSlotId(time);
+	for (const auto& slot : _slots)
+	{
+		if (slot.histogram && slot.id > id - (int64_t)SLOTS && slot.id <= id)
+			histogram.merge(*slot.histogram);
+	}
+}
+
+inline ScriptProfileStats ScriptProfile::getStats(const LatencyHistogram& histogram)
+{
+	ScriptProfileStats stats;
+	stats.calls = histogram.count();
+	stats.callsPerSecond = (double)histogram.count() / (SLOT_SECONDS * SLOTS);
+	stats.total = (double)histogram.total() / 1e6;
+	stats.p50 = (double)histogram.percentile(50.0) / 1e6;
+	stats.p99 = (double)histogram.percentile(99.0) / 1e6;
+	stats.max = (double)histogram.max() / 1e6;
+	return stats;
+}
+
+inline ScriptProfileStats ScriptProfile::getStats(const time_point& time) const
+{
+	LatencyHistogram histogram;
+	mergeInto(histogram, time);
+	return getStats(histogram);
+}
+
+#endif
@@ -22,6 +22,9 @@ class IScriptEnv
 		virtual void CallFunctionInScope(std::function<void()> function) = 0;
 		virtual void TerminateExecution() = 0;
 
+		// Run the pending promise handlers
+		virtual void RunMicrotasks() = 0;
+
 		const ScriptRunError& getScriptError() const {
 			return _lastScriptError;
 		}
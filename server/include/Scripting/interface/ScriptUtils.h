@@ -4,12 +4,18 @@
 #define SCRIPTUTILS_H
 
 #include <chrono>
+#include <cstddef>
 #include <string>
 
-struct ScriptTimeSample
+//! Counters of a compiled script cache. Scripts are keyed by a hash of their source, so the
+//! source itself isn't kept.
+struct ScriptCacheStats
 {
-	double sample;
-	std::chrono::high_resolution_clock::time_point sample_time;
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t entries = 0;
+	size_t sourceBytes = 0;		// source of the cached scripts, counted once each
+	size_t reusedBytes = 0;		// source served from the cache instead of being compiled again
 };
 
 class ScriptRunError
@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef V8CODECACHE_H
+#define V8CODECACHE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <v8.h>
+#include "ContentHash.h"
+
+//! Lookups of the code cache since the server started
+struct CodeCacheStats
+{
+	size_t hits = 0;		// scripts v8 compiled from their cache
+	size_t misses = 0;		// scripts without a usable cache
+	size_t rejected = 0;	// caches v8 refused, counted as misses too
+};
+
+//! Keeps v8 code caches of compiled scripts on disk, so scripts that haven't changed skip
+//! parsing and compiling on the next start. Caches are stored by a hash of the script source,
+//! and carry the v8 version/flags tag so caches from another build are never used. The source
+//! is stored along with it, so a script that only shares the hash never gets another's cache.
+//! Writing happens on a background thread, which also removes caches that went unused for
+//! longer than the maximum age, such as those of scripts that were changed or deleted.
+class V8CodeCache
+{
+public:
+	//! \param pDirectory directory the cache files are kept in, created if it doesn't exist
+	//! \param pMaxAge caches that weren't used for this long are removed on startup, zero keeps them all
+	V8CodeCache(std::string pDirectory, std::chrono::hours pMaxAge);
+	~V8CodeCache();
+
+	// Delete copy and move operations
+	V8CodeCache(const V8CodeCache&) = delete;
+	V8CodeCache& operator=(const V8CodeCache&) = delete;
+	V8CodeCache(V8CodeCache&&) = delete;
+	V8CodeCache& operator=(V8CodeCache&&) = delete;
+
+	//! Load the cache of a script
+	//! \param pSource script source
+	//! \return nullptr if there is no usable cache
+	std::unique_ptr<v8::ScriptCompiler::CachedData> load(const std::string& pSource);
+
+	//! Write the cache of a script, replacing any older one
+	//! \param pSource script source
+	//! \param pScript compiled script to create the cache from
+	void store(const std::string& pSource, v8::Local<v8::UnboundScript> pScript);
+
+	const CodeCacheStats& getStats() const	{ return stats; }
+
+	//! Count a cache v8 refused to use, it is rewritten by the following store()
+	void reject()				{ ++stats.rejected; --stats.hits; ++stats.misses; }
+
+private:
+	struct PendingWrite
+	{
+		std::string path;
+		std::vector<uint8_t> data;
+	};
+
+	std::string getPath(const utilities::ContentHash& pHash) const;
+	void prune();
+	void writer();
+
+	std::string directory;
+	std::chrono::hours maxAge;
+	uint32_t versionTag;
+	CodeCacheStats stats;
+
+	std::mutex lock;
+	std::condition_variable writeCondition;
+	std::deque<PendingWrite> writes;
+	bool running;
+	std::thread writeThread;
+};
+
+#endif
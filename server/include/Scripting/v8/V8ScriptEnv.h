@@ -7,8 +7,10 @@
 #include <vector>
 #include <v8.h>
 #include "ScriptBindings.h"
+#include "V8CodeCache.h"
 #include "V8ScriptObject.h"
 #include "V8ScriptUtils.h"
+#include "V8Snapshot.h"
 
 class IScriptFunction;
 
@@ -26,6 +28,7 @@ public:
 	IScriptFunction * Compile(const std::string& name, const std::string& source) override;
 	void CallFunctionInScope(std::function<void()> function) override;
 	void TerminateExecution() override;
+	void RunMicrotasks() override;
 
 	// Parse errors from a TryCatch into lastScriptError 
 	bool ParseErrors(v8::TryCatch *tryCatch);
@@ -41,6 +44,24 @@ public:
 	void SetGlobalTemplate(v8::Local<v8::ObjectTemplate> global_tpl);
 	bool SetConstructor(const std::string& key, v8::Local<v8::FunctionTemplate> func_tpl);
 
+	// Code cache used by Compile(), nullptr to compile everything from source
+	V8CodeCache * GetCodeCache() const;
+	void SetCodeCache(std::unique_ptr<V8CodeCache> codeCache);
+
+	// Startup snapshots, these have to be set before Initialize()
+	void SetExternalReferences(std::vector<intptr_t> references);
+	void SetStartupSnapshot(std::unique_ptr<V8Snapshot> snapshot);
+	void EnableSnapshotCreation();
+
+	// Whether the isolate was started from a snapshot, which holds the bound classes already
+	bool HasStartupSnapshot() const;
+
+	// Take the bootstrap function out of the startup snapshot
+	IScriptFunction * GetSnapshotBootstrap();
+
+	// Snapshot the bound classes and the compiled bootstrap, the environment can only be cleaned up afterwards
+	bool CreateSnapshot(V8Snapshot& snapshot, std::unique_ptr<IScriptFunction> bootstrap);
+
 	// --
 	template<class T>
 	std::unique_ptr<IScriptObject<T>> Wrap(const std::string& constructor_name, T* obj);
@@ -59,6 +80,14 @@ private:
 	v8::Persistent<v8::Object> _global;
 	v8::Persistent<v8::ObjectTemplate> _global_tpl;
 	std::unordered_map<std::string, v8::Global<v8::FunctionTemplate>> _constructorMap;
+	std::unique_ptr<V8CodeCache> _codeCache;
+
+	// Startup snapshot
+	std::vector<intptr_t> _externalReferences;
+	std::unique_ptr<V8Snapshot> _snapshot;
+	std::unique_ptr<v8::SnapshotCreator> _snapshotCreator;
+	v8::StartupData _startupData;
+	bool _createSnapshot;
 };
 
 inline v8::Isolate * V8ScriptEnv::Isolate() const
@@ -99,6 +128,38 @@ inline v8::Local<v8::FunctionTemplate> V8ScriptEnv::GetConstructor(const std::st
 	return GlobalPersistentToLocal(Isolate(), (*it).second);
 }
 
+inline V8CodeCache * V8ScriptEnv::GetCodeCache() const
+{
+	return _codeCache.get();
+}
+
+inline void V8ScriptEnv::SetCodeCache(std::unique_ptr<V8CodeCache> codeCache)
+{
+	_codeCache = std::move(codeCache);
+}
+
+inline void V8ScriptEnv::SetExternalReferences(std::vector<intptr_t> references)
+{
+	// v8 expects the list to end with a null entry
+	_externalReferences = std::move(references);
+	_externalReferences.push_back(0);
+}
+
+inline void V8ScriptEnv::SetStartupSnapshot(std::unique_ptr<V8Snapshot> snapshot)
+{
+	_snapshot = std::move(snapshot);
+}
+
+inline void V8ScriptEnv::EnableSnapshotCreation()
+{
+	_createSnapshot = true;
+}
+
+inline bool V8ScriptEnv::HasStartupSnapshot() const
+{
+	return (_snapshot != nullptr);
+}
+
 template<class T>
 inline std::unique_ptr<IScriptObject<T>> V8ScriptEnv::Wrap(const std::string& constructor_name, T *obj)
 {
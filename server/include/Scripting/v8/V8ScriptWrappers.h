@@ -5,59 +5,7 @@
 
 #include <cstring>
 #include <string>
-#include <regex>
-#include <iostream>
-
-const std::regex word_regex(R"((public[\s]+function[\s]+){1}(\w+)[\s]*\()");
-
-//TODO: Move to CPP-file
-inline std::string getPublicFunctions(const std::string_view& code)
-{
-	std::vector<std::string> eventList;
-
-	std::string s(code);
-
-	auto words_begin = std::sregex_iterator(s.begin(), s.end(), word_regex);
-	auto words_end = std::sregex_iterator();
-
-	for (std::sregex_iterator i = words_begin; i != words_end; ++i) {
-		std::smatch match = *i;
-
-		std::string match_str = match.str();
-		if (match.size() == 3)
-			eventList.push_back(match[2]);
-	}
-
-	std::string varNames = "";
-	std::string varNameQuotes = "";
-	for (const auto eventName : eventList) {
-		varNames += eventName + ",";
-		varNameQuotes += "\"" + eventName + "\"" + ",";
-	}
-	if (!varNames.empty()) {
-		varNames.pop_back();
-		varNameQuotes.pop_back();
-	}
-
-	std::string out;
-	if (!varNames.empty())
-	{
-		out += "const __publicNames = [" + varNameQuotes + "];\n";
-		out += "const __publicFuncs = [" + varNames + "];\n";
-		out += R"(
-			for (let i = 0; i < __publicNames.length; ++i) {
-				if (__publicFuncs[i]) {
-					//print("Found fn ", __publicNames[i]);
-					self[__publicNames[i]] = __publicFuncs[i];
-				} else {
-					//print("Not found fn ", __publicNames[i]);
-				}
-			}
-		)";
-	}
-
-	return out;
-}
+#include "ScriptPreprocessor.h"
 
 template <typename T>
 inline std::string WrapScript(const std::string& code) {
@@ -90,11 +38,8 @@ inline std::string WrapScript<TNPC>(const std::string_view& code) {
 
 	std::string wrappedCode = std::string(prefixString);
 
-	std::string publicFunctions = getPublicFunctions(code);
-	std::string fixedCode = std::regex_replace(std::string(code), word_regex, "function $2(");
-
-	wrappedCode.append(fixedCode);
-	wrappedCode.append(publicFunctions);
+	auto publicFunctions = stripPublicFunctions(code, wrappedCode);
+	wrappedCode.append(getPublicFunctionExports(publicFunctions));
 	wrappedCode.append("\n});");
 	return wrappedCode;
 }
@@ -107,11 +52,8 @@ inline std::string WrapScript<TPlayer>(const std::string_view& code) {
 
 	std::string wrappedCode = std::string(prefixString);
 
-	std::string publicFunctions = getPublicFunctions(code);
-	std::string fixedCode = std::regex_replace(std::string(code), word_regex, "function $2(");
-
-	wrappedCode.append(fixedCode);
-	wrappedCode.append(publicFunctions);
+	auto publicFunctions = stripPublicFunctions(code, wrappedCode);
+	wrappedCode.append(getPublicFunctionExports(publicFunctions));
 	wrappedCode.append("\n});");
 	return wrappedCode;
 }
@@ -127,11 +69,8 @@ inline std::string WrapScript<TWeapon>(const std::string_view& code) {
 
 	std::string wrappedCode = std::string(prefixString);
 
-	std::string publicFunctions = getPublicFunctions(code);
-	std::string fixedCode = std::regex_replace(std::string(code), word_regex, "function $2(");
-
-	wrappedCode.append(fixedCode);
-	wrappedCode.append(publicFunctions);
+	auto publicFunctions = stripPublicFunctions(code, wrappedCode);
+	wrappedCode.append(getPublicFunctionExports(publicFunctions));
 	wrappedCode.append("\n});");
 	return wrappedCode;
 }
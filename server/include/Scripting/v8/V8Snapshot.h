@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef V8SNAPSHOT_H
+#define V8SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! Native callbacks of the script bindings, generated from the binding sources by
+//! cmake/generate_v8_references.cmake.
+std::vector<intptr_t> getV8CallbackReferences();
+
+//! Checksum of the binding sources, generated along with the callback references.
+uint32_t getV8BindingsChecksum();
+
+//! A v8 startup snapshot holding the bound classes and the compiled bootstrap script, built by
+//! the v8snapshot target. Starting an isolate from it skips binding the classes and compiling
+//! the bootstrap.
+//! Isolate data 0 is the global template, followed by the constructors in order. Context 0 is
+//! the bootstrap context, with the bootstrap function as its data 0.
+struct V8Snapshot
+{
+	uint32_t versionTag;		// v8 version and flags it was built with
+	uint32_t bootstrapChecksum;	// crc32 of the bootstrap script it was built from
+	uint32_t bindingsChecksum;	// getV8BindingsChecksum() of the build it was made by
+	uint32_t referenceCount;	// number of external references it was built with
+	std::vector<std::string> constructors;
+	std::string blob;
+
+	//! Load a snapshot file
+	//! \return false if the file is missing or damaged
+	bool load(const std::string& pPath);
+
+	//! Write a snapshot file
+	bool save(const std::string& pPath) const;
+};
+
+#endif
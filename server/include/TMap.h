@@ -1,6 +1,8 @@
 #ifndef TGMAP_H
 #define TGMAP_H
 
+#include <algorithm>
+#include <cstdint>
 #include <ctime>
 #include <map>
 #include <string>
@@ -58,6 +60,18 @@ class TMap
 		bool isGmap() const						{ return type == MapType::GMAP; }
 		bool isGroupMap() const					{ return groupMap; }
 
+		// Players on the map, bucketed by level position and by group on group maps.
+		void addPlayer(uint16_t id, int mx, int my, const std::string& group);
+		void removePlayer(uint16_t id, int mx, int my, const std::string& group);
+
+		//! Call a function for every player within one level of a map position
+		//! \param mx map x position
+		//! \param my map y position
+		//! \param group player group, or nullptr to visit every group
+		//! \param fn function called with each player id
+		template<typename Fn>
+		void forEachPlayerNear(int mx, int my, const std::string* group, Fn&& fn) const;
+
 	private:
 		bool loadBigMap(const CString& pFileName, TServer* pServer);
 		bool loadGMap(const CString& pFileName, TServer* pServer);
@@ -75,6 +89,40 @@ class TMap
 		std::unordered_map<std::string, SMapLevel> levels;
         std::vector<std::string> _levelList;
 		std::vector<std::string> preloadLevelList;
+
+		struct PlayerGrid
+		{
+			std::vector<std::vector<uint16_t>> cells;
+			size_t count = 0;
+		};
+
+		const std::string& getGridKey(const std::string& group) const;
+		std::unordered_map<std::string, PlayerGrid> playerGrids;
 };
 
+template<typename Fn>
+void TMap::forEachPlayerNear(int mx, int my, const std::string* group, Fn&& fn) const
+{
+	auto visit = [&](const PlayerGrid& grid) {
+		int maxX = std::min(mx + 1, (int)width - 1);
+		int maxY = std::min(my + 1, (int)height - 1);
+		for (int y = std::max(my - 1, 0); y <= maxY; ++y)
+		{
+			for (int x = std::max(mx - 1, 0); x <= maxX; ++x)
+			{
+				for (auto id : grid.cells[x + y * width])
+					fn(id);
+			}
+		}
+	};
+
+	if (group == nullptr)
+	{
+		for (const auto& [key, grid] : playerGrids)
+			visit(grid);
+	}
+	else if (auto it = playerGrids.find(getGridKey(*group)); it != playerGrids.end())
+		visit(it->second);
+}
+
 #endif
@@ -168,12 +168,6 @@ enum
 	NPCEVENTFLAG_NPCWARPED		= (int)(1 << 8),
 };
 
-struct ScriptEventTimer
-{
-	unsigned int timer;
-	ScriptAction action;
-};
-
 #endif
 
 class TServer;
@@ -261,7 +255,7 @@ class TNPC
 		unsigned char getSprite() const			{ return sprite; }
 		int getBlockFlags() const 				{ return blockFlags; }
 		int getVisibleFlags() const 			{ return visFlags; }
-		int getTimeout() const 					{ return timeout; }
+		int getTimeout() const;
 
 		const SourceCode& getSource() const		{ return npcScript; }
 		const std::string& getName() const		{ return npcName; }
@@ -325,7 +319,8 @@ class TNPC
 		void registerTriggerAction(const std::string& action, IScriptFunction *cbFunc);
 		void scheduleEvent(unsigned int timeout, ScriptAction& action);
 
-		bool runScriptTimer();
+		void runTimeout();
+		void runScheduledEvent(uint64_t timerId, ScriptAction& action);
 		NPCEventResponse runScriptEvents();
 
 		CString getVariableDump();
@@ -363,7 +358,6 @@ class TNPC
 		CString npcBytecode;
 
 #ifdef V8NPCSERVER
-		bool hasTimerUpdates() const;
 		void freeScriptResources();
 		void testTouch();
 		void testForLinks();
@@ -386,7 +380,8 @@ class TNPC
 		std::unique_ptr<IScriptObject<TNPC>> _scriptObject;
 		ScriptExecutionContext _scriptExecutionContext;
 		std::unordered_map<std::string, IScriptFunction *> _triggerActions;
-		std::vector<ScriptEventTimer> _scriptTimers;
+		std::unordered_set<uint64_t> _scriptTimers;
+		uint64_t _timeoutTimer;
 #endif
 };
 
@@ -622,10 +617,6 @@ inline void TNPC::allowNpcWarping(NPCWarpType canWarp)
 /**
  * Script Engine
  */
-inline bool TNPC::hasTimerUpdates() const {
-	return (timeout > 0 || !_scriptTimers.empty());
-}
-
 inline bool TNPC::hasScriptEvent(int flag) const {
 	return ((_scriptEventsMask & flag) == flag);
 }
@@ -685,7 +676,8 @@ inline void TNPC::registerNpcUpdates()
 }
 
 inline void TNPC::scheduleEvent(unsigned int timeout, ScriptAction& action) {
-	_scriptTimers.push_back({ timeout, std::move(action) });
+	CScriptEngine *scriptEngine = server->getScriptEngine();
+	_scriptTimers.insert(scriptEngine->ScheduleNpcEvent(this, timeout, std::move(action)));
 }
 
 #endif
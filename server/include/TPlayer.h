@@ -8,10 +8,11 @@
 #include <vector>
 #include <memory>
 #include "IEnums.h"
-#include "CFileQueue.h"
+#include "CPacketQueue.h"
 #include "TAccount.h"
 #include "CEncryption.h"
 #include "CSocket.h"
+#include "RingBuffer.h"
 
 #ifdef V8NPCSERVER
 #include "ScriptBindings.h"
@@ -85,6 +86,7 @@ class TPlayer : public TAccount, public CSocketStub, public std::enable_shared_f
 		std::shared_ptr<TLevel> getLevel() const;
 		std::weak_ptr<TMap> getMap()	{ return pmap; }
 		CString getGroup()				{ return levelGroup; }
+		const std::string& getMapGroup() const	{ return mapGroup; }
 		uint16_t getId() const;
 		time_t getLastData() const		{ return lastData; }
 		CString getGuild() const		{ return guild; }
@@ -93,17 +95,17 @@ class TPlayer : public TAccount, public CSocketStub, public std::enable_shared_f
 		bool isUsingFileBrowser() const	{ return isFtp; }
 		CString getServerName()	const	{ return serverName; }
 		const CString& getPlatform() const { return os; }
-		std::pair<int, int> getMapPosition() const;
+		std::pair<int, int> getMapPosition() const	{ return { mapX, mapY }; }
 
 		// Set Properties
 		void setChat(const CString& pChat);
 		void setNick(CString pNickName, bool force = false);
 		void setId(uint16_t pId);
 		void setLoaded(bool loaded)		{ this->loaded = loaded; }
-		void setGroup(CString group)	{ levelGroup = group; }
+		void setGroup(CString group);
 		void deleteFlag(const std::string& pFlagName, bool sendToPlayer = false);
 		void setFlag(const std::string& pFlagName, const CString& pFlagValue, bool sendToPlayer = false);
-		void setMap(std::shared_ptr<TMap> map)			{ pmap = map; }
+		void setMap(std::shared_ptr<TMap> map);
 		void setServerName(CString& tmpServerName)	{ serverName = tmpServerName; }
 
 		// Level manipulation
@@ -128,6 +130,10 @@ class TPlayer : public TAccount, public CSocketStub, public std::enable_shared_f
 		// Socket-Functions
 		bool doMain();
 		void sendPacket(CString pPacket, bool appendNL = true);
+		void sendPacket(const SharedPacket& pPacket);
+
+		//! Send the packets queued since the last flush, combined into as few frames as possible
+		void flushPackets();
 		bool sendFile(const CString& pFile);
 		bool sendFile(const CString& pPath, const CString& pFile);
 
@@ -332,6 +338,7 @@ class TPlayer : public TAccount, public CSocketStub, public std::enable_shared_f
 		bool sendLoginRC();
 
 		// Packet functions.
+		void scheduleSend();
 		bool parsePacket(CString& pPacket);
 		void decryptPacket(CString& pPacket);
 
@@ -346,7 +353,10 @@ class TPlayer : public TAccount, public CSocketStub, public std::enable_shared_f
 
 		// Socket Variables
 		CSocket *playerSock;
-		CString rBuffer;
+		RingBuffer rBuffer;
+#if defined(WOLFSSL_ENABLED)
+		CString wsBuffer;	// websocket frames that haven't fully arrived yet
+#endif
 
 		// Encryption
 		unsigned char key;
@@ -366,6 +376,14 @@ class TPlayer : public TAccount, public CSocketStub, public std::enable_shared_f
 		std::unordered_set<std::string> knownFiles;
 		std::weak_ptr<TMap> pmap;
 
+		// Our position on the map and our bucket in its player grid. Kept up to date
+		// as we change levels and groups so area sends don't have to look anything up.
+		void addToMapGrid();
+		void removeFromMapGrid();
+		std::weak_ptr<TMap> gridMap;
+		int mapX, mapY;
+		std::string mapGroup;
+
 		std::unordered_map<uint16_t, std::shared_ptr<TPlayer>> externalPlayers;
 		std::set<uint16_t> freeExternalPlayerIds;
 		uint16_t nextExternalPlayerId;
@@ -388,7 +406,7 @@ class TPlayer : public TAccount, public CSocketStub, public std::enable_shared_f
 		CString grExecParameterList;
 
 		// File queue.
-		CFileQueue fileQueue;
+		CPacketQueue fileQueue;
 
 #ifdef V8NPCSERVER
 		bool _processRemoval;
@@ -17,6 +17,7 @@
 #include "CString.h"
 #include "CLog.h"
 #include "CFileSystem.h"
+#include "CPacketQueue.h"
 #include "CSettings.h"
 #include "CSocket.h"
 #include "CTranslationManager.h"
@@ -24,6 +25,13 @@
 #include "TServerList.h"
 
 #include "CommandDispatcher.h"
+#include "FileCache.h"
+#include "FileTransfer.h"
+#include "FileSystemWatcher.h"
+
+#ifdef __linux__
+#include "EpollSocketManager.h"
+#endif
 
 #ifdef UPNP
 #include "CUPNP.h"
@@ -31,6 +39,7 @@
 
 #ifdef V8NPCSERVER
 #include "CScriptEngine.h"
+#include "ScriptProfile.h"
 #endif
 
 #include "GS2ScriptManager.h"
@@ -68,6 +77,12 @@ enum
 
 using AnimationManager = ResourceManager<TGameAni, TServer *>;
 using PackageManager = ResourceManager<TUpdatePackage, TServer *>;
+
+#ifdef __linux__
+using ServerSocketManager = EpollSocketManager;
+#else
+using ServerSocketManager = CSocketManager;
+#endif
 using TriggerDispatcher = CommandDispatcher<std::string, TPlayer *, std::vector<CString>&>;
 
 class TServer : public CSocketStub
@@ -92,13 +107,20 @@ class TServer : public CSocketStub
 		int init(const CString& serverip = "", const CString& serverport = "", const CString& localip = "", const CString& serverinterface = "");
 		bool doMain();
 
+		//! Let the socket manager know a socket has output queued
+		//! \param stub socket to service
+		//! \param delay time from now until it can send
+		void requestSend(CSocketStub* stub, std::chrono::nanoseconds delay = std::chrono::nanoseconds::zero());
+
 		// Server Management
 		int loadConfigFiles();
 		void loadSettings();
 		void loadAdminSettings();
 		void loadAllowedVersions();
 		void loadFileSystem();
+		void updateFileSystems(bool wait = false);
 		void loadServerFlags();
+		void loadChecksums();
 		void loadServerMessage();
 		void loadIPBans();
 		void loadClasses(bool print = false);
@@ -115,10 +137,13 @@ class TServer : public CSocketStub
 		void loadFolderConfig();
 
 		void saveServerFlags();
+		void saveChecksums();
 		void saveWeapons();
 #ifdef V8NPCSERVER
 		void saveNpcs();
-		std::vector<std::pair<double, std::string>> calculateNpcStats();
+		//! Execution times of the npc and weapon scripts in the last minute, most time first
+		//! \param perEvent list each event of a script on its own
+		std::vector<std::pair<std::string, ScriptProfileStats>> calculateNpcStats(bool perEvent = false);
 #endif
 
 		void reportScriptException(const ScriptRunError& error);
@@ -134,7 +159,9 @@ class TServer : public CSocketStub
 		CLog& getScriptLog()							{ return scriptlog; }
 		CSettings& getSettings()						{ return settings; }
 		CSettings& getAdminSettings()					{ return adminsettings; }
-		CSocketManager& getSocketManager()				{ return sockManager; }
+		ServerSocketManager& getSocketManager()			{ return sockManager; }
+		BroadcastFrameCache& getBroadcastFrameCache()	{ return broadcastFrameCache; }
+		OutboundLimits& getOutboundLimits()				{ return outboundLimits; }
 		CString getServerPath() const					{ return serverpath; }
 		const CString& getServerMessage() const			{ return servermessage; }
 		const CString& getAllowedVersionString() const	{ return allowedVersionString; }
@@ -143,6 +170,8 @@ class TServer : public CSocketStub
 		TServerList& getServerList()					{ return serverlist; }
 		AnimationManager& getAnimationManager()			{ return animationManager; }
 		PackageManager& getPackageManager()				{ return packageManager; }
+		FileCache& getFileCache()						{ return fileCache; }
+		PrecompressedFileStore& getPrecompressedFiles()	{ return precompressedFiles; }
 		unsigned int getNWTime() const					{ return serverTime; }
 		void calculateServerTime();
 
@@ -152,11 +181,12 @@ class TServer : public CSocketStub
 		std::unordered_map<std::string, std::shared_ptr<TWeapon>>& getWeaponList()		{ return weaponList; }
 		std::unordered_map<uint16_t, std::shared_ptr<TPlayer>>& getPlayerList()			{ return playerList; }
 		std::unordered_map<uint32_t, std::shared_ptr<TNPC>>& getNPCList()				{ return npcList; }
-		std::vector<std::shared_ptr<TLevel>>& getLevelList()							{ return levelList; }
+		const std::vector<std::shared_ptr<TLevel>>& getLevelList() const				{ return levelList; }
 		const std::vector<std::shared_ptr<TMap>>& getMapList() const					{ return mapList; }
 		const std::vector<CString>& getStatusList() const								{ return statusList; }
 		const std::vector<CString>& getAllowedVersions() const							{ return allowedVersions; }
 		std::unordered_multimap<std::string, std::weak_ptr<TLevel>>& getGroupLevels()	{ return groupLevels; }
+		const GS2ScriptManager& getGS2ScriptManager() const							{ return gs2ScriptManager; }
 
 #ifdef V8NPCSERVER
 		CScriptEngine * getScriptEngine() { return &mScriptEngine; }
@@ -167,6 +197,8 @@ class TServer : public CSocketStub
 		CFileSystem* getFileSystemByType(CString& type);
 		CString getFlag(const std::string& pFlagName);
 		std::shared_ptr<TLevel> getLevel(const std::string& pLevel);
+		std::shared_ptr<TLevel> findLoadedLevel(const CString& pLevelName) const;
+		void addLevel(const std::shared_ptr<TLevel>& pLevel);
 		std::shared_ptr<TNPC> getNPC(const uint32_t id) const;
 		std::shared_ptr<TPlayer> getPlayer(const uint16_t id) const;
 		std::shared_ptr<TPlayer> getPlayer(const uint16_t id, int type) const; // = PLTYPE_ANYCLIENT) const;
@@ -270,15 +302,20 @@ private:
 
 		bool doRestart;
 
+		FileSystemWatcher fileWatcher;
 		CFileSystem filesystem[FS_COUNT], filesystem_accounts;
 		CLog npclog, rclog, serverlog, scriptlog; //("logs/npclog|rclog|serverlog|scriptlog.txt");
 		CSettings adminsettings, settings;
 		CSocket playerSock;
-		CSocketManager sockManager;
+		ServerSocketManager sockManager;
+		BroadcastFrameCache broadcastFrameCache;
+		OutboundLimits outboundLimits;
 		CTranslationManager mTranslationManager;
 		CWordFilter wordFilter;
 		AnimationManager animationManager;
 		PackageManager packageManager;
+		FileCache fileCache;
+		PrecompressedFileStore precompressedFiles;
 		CString allowedVersionString, name, servermessage, serverpath;
 		CString overrideIP, overrideLocalIP, overridePort, overrideInterface;
 
@@ -295,6 +332,7 @@ private:
 
 		std::vector<std::shared_ptr<TMap>> mapList;
 		std::vector<std::shared_ptr<TLevel>> levelList;
+		std::unordered_map<std::string, std::shared_ptr<TLevel>> levelNameIndex;
 		std::unordered_multimap<std::string, std::weak_ptr<TLevel>> groupLevels;
 
 		std::unordered_map<uint16_t, std::shared_ptr<TPlayer>> playerList;
@@ -303,7 +341,7 @@ private:
 		std::unordered_set<std::shared_ptr<TPlayer>> deletedPlayers;
 
 		TServerList serverlist;
-		std::chrono::high_resolution_clock::time_point lastTimer, lastNWTimer, last1mTimer, last5mTimer, last3mTimer;
+		std::chrono::high_resolution_clock::time_point lastTimer, lastNWTimer, last1mTimer, last5mTimer, last3mTimer, lastFlushTimer;
 		std::time_t serverStartTime;
 		unsigned int serverTime;
 
@@ -1,12 +1,15 @@
 #ifndef TSERVERLIST_H
 #define TSERVERLIST_H
 
+#include <atomic>
 #include <memory>
 #include <map>
 #include <time.h>
 #include "CFileQueue.h"
 #include "CString.h"
 #include "CSocket.h"
+#include "RingBuffer.h"
+#include "WakeupEvent.h"
 #include <assert.h> 
 
 enum
@@ -28,9 +31,9 @@ class TServerList : public CSocketStub
 		bool onSend();
 		bool onRegister()			{ return true; }
 		void onUnregister();
-		SOCKET getSocketHandle()	{ return sock.getHandle(); }
+		SOCKET getSocketHandle()	{ return sock->getHandle(); }
 		bool canRecv();
-		bool canSend()				{ return _fileQueue.canSend(); }
+		bool canSend()				{ return !isConnecting() && _fileQueue->canSend(); }
 
 		// Constructor - Deconstructor
 		TServerList(TServer *server);
@@ -40,9 +43,11 @@ class TServerList : public CSocketStub
 		
 		// Socket-Control Functions
 		bool getConnected() const;
+		bool isConnecting() const				{ return pendingConnect != nullptr; }
 		bool main();
 		bool connectServer();
-		CSocket& getSocket()					{ return sock; }
+		void disconnect();
+		CSocket& getSocket()					{ return *sock; }
 		void sendPacket(CString& pPacket, bool sendNow = false);
 
 		// Send players to the listserver
@@ -99,15 +104,34 @@ class TServerList : public CSocketStub
 		// Packet Functions
 		bool parsePacket(CString& pPacket);
 
+		// Connection Functions
+		bool finishConnect();
+		void checkConnect();
+		void scheduleReconnect();
+		void sendHandshake();
+
 		// Socket Variables
 		bool nextIsRaw;
 		int rawPacketSize;
-		CFileQueue _fileQueue;
-		CString readBuffer;
-		CSocket sock;
+		std::unique_ptr<CFileQueue> _fileQueue;
+		RingBuffer readBuffer;
+		std::unique_ptr<CSocket> sock;
 		time_t lastData, lastTimer;
 		time_t nextConnectionAttempt;
 		uint8_t connectionAttempts;
+
+		// A connect runs on a socket of its own, which only replaces ours once it succeeds.
+		// disconnect() can abandon it, the connecting thread then closes the socket when it's done.
+		// The thread signals connectDone when it finishes, which wakes the main loop to pick up
+		// the result. Without eventfd it is picked up by doTimedEvents(), up to a second later.
+		enum { CONNECT_PENDING, CONNECT_OK, CONNECT_INITFAILED, CONNECT_FAILED };
+		struct ConnectAttempt
+		{
+			std::unique_ptr<CSocket> sock;
+			std::atomic<int> result{ CONNECT_PENDING };
+		};
+		std::shared_ptr<ConnectAttempt> pendingConnect;
+		std::shared_ptr<WakeupEvent> connectDone;
 		TServer *_server;
 
 		std::map<std::string, int> serverListCount;
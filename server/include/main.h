@@ -5,7 +5,11 @@
 
 bool parseArgs(int argc, char* argv[]);
 void printHelp(const char* pname);
-std::string getBaseHomePath();
 void shutdownServer(int signal);
 
+// Defined in ServerGlobals.cpp, which is part of the server library.
+extern CString homePath;
+std::string getBaseHomePath();
+void getBasePath();
+
 #endif // MAIN_H
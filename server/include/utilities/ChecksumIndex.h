@@ -0,0 +1,54 @@
+#ifndef GS2EMU_CHECKSUMINDEX_H
+#define GS2EMU_CHECKSUMINDEX_H
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+//! CRC-32 checksums of files, keyed by path and only valid for the size and
+//! modification time they were calculated for. Saved to disk so checksums
+//! survive a restart, and pruned of files that changed or went away when loaded.
+class ChecksumIndex
+{
+public:
+	ChecksumIndex() : dirty(false) { }
+
+	//! Find the checksum for a file
+	//! \param path full path to the file
+	//! \param size current size of the file
+	//! \param modTime current modification time of the file
+	//! \return the checksum if it was calculated for this version of the file
+	std::optional<uint32_t> find(const std::string& path, long long size, time_t modTime) const;
+
+	void add(const std::string& path, long long size, time_t modTime, uint32_t checksum);
+	void clear();
+
+	//! Remove the checksums of files that no longer exist or no longer match their size and modification time
+	//! \return number of checksums removed
+	size_t prune();
+
+	//! Load checksums saved by save(), replacing the current ones, and prune them
+	//! \param file file to load from
+	//! \return false if the file couldn't be opened
+	bool load(const std::string& file);
+
+	//! Save the checksums if any changed since the last load or save
+	//! \param file file to save to
+	//! \return false if the file couldn't be written
+	bool save(const std::string& file);
+
+private:
+	struct Entry
+	{
+		long long size;
+		time_t modTime;
+		uint32_t checksum;
+	};
+
+	std::unordered_map<std::string, Entry> entries;
+	bool dirty;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef GS2EMU_CONTENTHASH_H
+#define GS2EMU_CONTENTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace utilities
+{
+	//! 128-bit hash of a block of data. It isn't cryptographic, so collisions can be crafted,
+	//! and caches of user content still compare the data itself on a hit.
+	struct ContentHash
+	{
+		uint64_t low;
+		uint64_t high;
+
+		bool operator==(const ContentHash& other) const { return low == other.low && high == other.high; }
+		bool operator!=(const ContentHash& other) const { return !(*this == other); }
+	};
+
+	//! MurmurHash3 (x64, 128-bit) with a zero seed.
+	//! \param data bytes to hash
+	//! \param length number of bytes
+	//! \return hash of the data
+	ContentHash contentHash(const char* data, size_t length);
+
+	inline ContentHash contentHash(std::string_view data)
+	{
+		return contentHash(data.data(), data.length());
+	}
+}
+
+template<>
+struct std::hash<utilities::ContentHash>
+{
+	size_t operator()(const utilities::ContentHash& hash) const noexcept
+	{
+		// Already well mixed, any half will do.
+		return (size_t)hash.low;
+	}
+};
+
+#endif
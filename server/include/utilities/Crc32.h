@@ -0,0 +1,24 @@
+#ifndef GS2EMU_CRC32_H
+#define GS2EMU_CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+#include "CString.h"
+
+namespace utilities
+{
+	//! CRC-32 (IEEE 802.3), the same checksum the client sends for its cached files.
+	//! Uses the ARMv8 CRC instructions when they are available, otherwise slicing-by-8.
+	//! \param data bytes to checksum
+	//! \param length number of bytes
+	//! \param crc checksum of the preceding data, to continue a checksum
+	//! \return checksum
+	uint32_t crc32(const char* data, size_t length, uint32_t crc = 0);
+
+	inline uint32_t crc32(const CString& data)
+	{
+		return crc32(data.text(), data.length());
+	}
+}
+
+#endif
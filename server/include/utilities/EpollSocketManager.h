@@ -0,0 +1,98 @@
+#ifndef GS2EMU_EPOLLSOCKETMANAGER_H
+#define GS2EMU_EPOLLSOCKETMANAGER_H
+
+#ifdef __linux__
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "CSocket.h"
+
+//! Epoll replacement for CSocketManager.
+//! Keeps the same interface so TServer, TPlayer and TServerList can register with
+//! either backend, and adds a timerfd so update() sleeps until the next I/O event
+//! or the wake-up deadline instead of polling.
+//! Sockets are only serviced when epoll reports them or they are put on the ready list
+//! with requestSend(), so a pass costs nothing for idle sockets. EPOLLOUT is only watched
+//! while a socket still has output left after onSend().
+class EpollSocketManager
+{
+public:
+	EpollSocketManager();
+	~EpollSocketManager();
+
+	// Delete copy and move operations
+	EpollSocketManager(const EpollSocketManager&) = delete;
+	EpollSocketManager& operator=(const EpollSocketManager&) = delete;
+	EpollSocketManager(EpollSocketManager&&) = delete;
+	EpollSocketManager& operator=(EpollSocketManager&&) = delete;
+
+	//! Unregister every socket
+	//! \param callOnUnregister call CSocketStub::onUnregister() for each socket
+	void cleanup(bool callOnUnregister = true);
+
+	//! Wait for socket events and dispatch them
+	//! \param sec maximum seconds to wait
+	//! \param usec maximum microseconds to wait
+	//! \return false if the epoll instance is unusable
+	bool update(long sec = 0, long usec = 0);
+
+	//! Service a single socket without waiting
+	//! \param stub socket to service
+	//! \param pRead try to receive data
+	//! \param pWrite try to send queued data
+	//! \return false if the socket was dropped
+	bool updateSingle(CSocketStub* stub, bool pRead = true, bool pWrite = true);
+
+	bool registerSocket(CSocketStub* stub);
+	bool unregisterSocket(CSocketStub* stub);
+
+	//! Have onSend() called on the next update, for a socket that just queued output.
+	//! Ignored during the socket's own onSend(), whatever it leaves waits for EPOLLOUT.
+	void requestSend(CSocketStub* stub);
+
+	//! Have onSend() called once a delay has passed, for output that is being throttled
+	//! \param stub socket to service
+	//! \param delay time from now until it can send again
+	void requestSend(CSocketStub* stub, std::chrono::nanoseconds delay);
+
+	//! Arm the wake-up timer, update() will return no later than this
+	//! \param delay time from now until the wake-up
+	void setWakeup(std::chrono::nanoseconds delay);
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct SocketEntry
+	{
+		CSocketStub* stub;
+		int handle;
+		bool ready;				// on the ready list
+		bool watchWrite;		// EPOLLOUT is armed
+		clock::time_point sendAt;	// pending timed send, or max()
+	};
+
+	void dropSocket(uint64_t id, bool callOnUnregister);
+	void setWatchWrite(SocketEntry& entry, uint64_t id, bool watch);
+	void markReady(SocketEntry& entry, uint64_t id);
+	int getTimeout(int timeout) const;
+
+	int epollFd;
+	int timerFd;
+	uint64_t nextId;
+	uint64_t sendingId;
+
+	std::unordered_map<uint64_t, SocketEntry> entries;
+	std::unordered_map<CSocketStub*, uint64_t> stubIds;
+
+	// Sockets to call onSend() for on the next update, and the ones waiting on a delay.
+	// Timed entries are left in place when they are replaced, and skipped if sendAt no longer matches.
+	std::vector<uint64_t> readyList;
+	std::multimap<clock::time_point, uint64_t> sendTimers;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef GS2EMU_FILECACHE_H
+#define GS2EMU_FILECACHE_H
+
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "CString.h"
+#include "ChecksumIndex.h"
+
+//! Contents of a file, as it was when it was loaded.
+struct CachedFile
+{
+	CString data;
+	time_t modTime;
+};
+
+//! Checksum of a file, along with the size it was calculated for.
+struct FileChecksum
+{
+	uint32_t checksum;
+	long long size;
+};
+
+//! Server-wide cache of file contents, so files that are sent to a lot of players are
+//! only read from disk once. Files are keyed by their full path and reloaded once their
+//! modification time or size changes. The least recently used files are dropped when the
+//! cache goes over its byte budget, but anyone still holding one keeps their copy.
+class FileCache
+{
+public:
+	explicit FileCache(size_t pMaxBytes = 64 * 1024 * 1024);
+
+	// Delete copy operations
+	FileCache(const FileCache&) = delete;
+	FileCache& operator=(const FileCache&) = delete;
+
+	//! Get the contents of a file, loading it if it isn't cached or has changed on disk
+	//! \param pPath full path to the file
+	//! \return nullptr if the file doesn't exist
+	std::shared_ptr<const CachedFile> get(const CString& pPath);
+
+	//! Get the CRC-32 checksum of a file, only reading the file if the checksum isn't known yet
+	//! \param pPath full path to the file
+	//! \return nullopt if the file doesn't exist
+	std::optional<FileChecksum> getChecksum(const CString& pPath);
+
+	ChecksumIndex& getChecksumIndex()	{ return checksums; }
+
+	//! Set the byte budget, dropping files if the cache is over it
+	void setMaxBytes(size_t pMaxBytes);
+
+	size_t getMaxBytes() const		{ return maxBytes; }
+	size_t getCachedBytes() const	{ return cachedBytes; }
+	void clear();
+
+private:
+	struct Entry
+	{
+		std::string path;
+		std::shared_ptr<const CachedFile> file;
+		long long size;
+	};
+
+	void erase(std::list<Entry>::iterator pEntry);
+	void evict();
+
+	// Most recently used first.
+	std::list<Entry> lru;
+	std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+	size_t maxBytes;
+	size_t cachedBytes;
+
+	ChecksumIndex checksums;
+};
+
+#endif
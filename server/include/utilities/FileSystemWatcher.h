@@ -0,0 +1,73 @@
+#ifndef GS2EMU_FILESYSTEMWATCHER_H
+#define GS2EMU_FILESYSTEMWATCHER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "CString.h"
+
+class CFileSystem;
+class TServer;
+
+//! Keeps CFileSystem file lists up to date from inotify events, so they don't need
+//! to be periodically rescanned. File systems opt in with CFileSystem::setWatcher().
+//! Without inotify, or if a directory can't be watched, isWatching() returns false
+//! and the file system has to be resynced the old way.
+class FileSystemWatcher
+{
+public:
+	explicit FileSystemWatcher(TServer* pServer);
+	~FileSystemWatcher();
+
+	// Delete copy and move operations
+	FileSystemWatcher(const FileSystemWatcher&) = delete;
+	FileSystemWatcher& operator=(const FileSystemWatcher&) = delete;
+	FileSystemWatcher(FileSystemWatcher&&) = delete;
+	FileSystemWatcher& operator=(FileSystemWatcher&&) = delete;
+
+	//! Watch a directory for a file system
+	//! \param pFileSystem file system to update
+	//! \param pDirectory full path of the directory, ending with the wildcard
+	//! \param pRecursive also add new sub-directories to the file system
+	//! \return false if the directory couldn't be watched
+	bool addDirectory(CFileSystem* pFileSystem, const CString& pDirectory, bool pRecursive);
+
+	//! Stop watching a directory for a file system
+	void removeDirectory(CFileSystem* pFileSystem, const CString& pDirectory);
+
+	//! Stop watching every directory of a file system
+	void removeFileSystem(CFileSystem* pFileSystem);
+
+	//! Whether every directory of the file system is being watched
+	bool isWatching(const CFileSystem* pFileSystem) const;
+
+	//! Apply any pending events without waiting
+	void update();
+
+private:
+	struct WatchTarget
+	{
+		CFileSystem* fs;
+		CString wildcard;
+		bool recursive;
+	};
+
+	struct WatchedDirectory
+	{
+		CString path;
+		std::vector<WatchTarget> targets;
+	};
+
+	void handleEvent(int pWatch, uint32_t pMask, const char* pName);
+	void resyncAll();
+
+	TServer* server;
+	int inotifyFd;
+
+	std::unordered_map<int, WatchedDirectory> watches;
+
+	// False once one of the file system's directories couldn't be watched.
+	std::unordered_map<const CFileSystem*, bool> fileSystems;
+};
+
+#endif
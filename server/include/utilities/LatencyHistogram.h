@@ -0,0 +1,54 @@
+#ifndef GS2EMU_LATENCYHISTOGRAM_H
+#define GS2EMU_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+//! Histogram of durations in microseconds, with log-linear buckets in the style of HdrHistogram.
+//! Every power of two is split into 8 buckets, so percentiles are within 12.5% of the real
+//! value while the histogram stays a fixed, small size. Durations of 2^25 us (about 33 seconds)
+//! and up share the last bucket; the maximum is kept exactly.
+class LatencyHistogram
+{
+public:
+	static constexpr unsigned SUB_BUCKET_BITS = 3;
+	static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+	static constexpr unsigned MAX_EXPONENT = 25;
+	static constexpr unsigned BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	LatencyHistogram() { clear(); }
+
+	//! Add a duration
+	//! \param micros duration in microseconds
+	void record(uint64_t micros);
+
+	//! Add the durations of another histogram
+	void merge(const LatencyHistogram& other);
+
+	void clear();
+
+	uint64_t count() const			{ return _count; }
+	uint64_t total() const			{ return _total; }
+	uint64_t max() const			{ return _max; }
+	bool empty() const				{ return _count == 0; }
+
+	//! Duration that a share of the recorded durations don't exceed
+	//! \param percentile share from 0 to 100
+	//! \return upper bound of the bucket holding it in microseconds, never above max()
+	uint64_t percentile(double percentile) const;
+
+	//! Bucket a duration is counted in
+	static size_t bucketIndex(uint64_t micros);
+
+	//! Highest duration counted in a bucket
+	static uint64_t bucketUpperBound(size_t index);
+
+private:
+	std::array<uint32_t, BUCKETS> _buckets;
+	uint64_t _count;
+	uint64_t _total;
+	uint64_t _max;
+};
+
+#endif
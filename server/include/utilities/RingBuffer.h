@@ -0,0 +1,48 @@
+#ifndef GS2EMU_RINGBUFFER_H
+#define GS2EMU_RINGBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//! Growable receive buffer for length-prefixed socket framing.
+//! Frames are consumed by advancing a read offset, so reading N queued frames
+//! doesn't move the remaining data N times. Unread data is only compacted to the
+//! front when a write would run off the end, which keeps it contiguous so frames
+//! can be handed out as views.
+class RingBuffer
+{
+public:
+	explicit RingBuffer(size_t capacity = 0x4000);
+
+	//! Append data to the end of the buffer
+	//! \param data bytes to append
+	//! \param len number of bytes
+	void write(const char* data, size_t len);
+
+	//! Discard bytes from the front of the buffer
+	//! \param len number of bytes to discard
+	void consume(size_t len);
+
+	void clear()							{ _head = _tail = 0; }
+
+	//! Read a big-endian short at an offset from the front, without consuming it
+	uint16_t peekShort(size_t offset = 0) const;
+
+	//! View of the unread data, valid until the next write()
+	std::string_view view() const			{ return { _buffer.data() + _head, length() }; }
+	std::string_view view(size_t offset, size_t len) const	{ return { _buffer.data() + _head + offset, len }; }
+
+	const char* data() const				{ return _buffer.data() + _head; }
+	size_t length() const					{ return _tail - _head; }
+	size_t capacity() const					{ return _buffer.size(); }
+	bool empty() const						{ return _head == _tail; }
+
+private:
+	std::vector<char> _buffer;
+	size_t _head;
+	size_t _tail;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef GS2EMU_TIMERWHEEL_H
+#define GS2EMU_TIMERWHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! Hierarchical timing wheel, keyed by absolute tick.
+//! Timers close to expiring sit in the 256 slots of the first level, one per tick. Timers
+//! further out sit in coarser levels and are moved down a level each time the level below
+//! wraps around, so a timer is only touched a few times no matter how long it waits.
+//! Adding and cancelling are O(1). Cancelled timers are only dropped from their slot once
+//! the wheel gets to it.
+template<typename T>
+class TimerWheel
+{
+public:
+	using TimerId = uint64_t;
+
+	TimerWheel() : now(0), nextId(1) { }
+
+	//! Arm a timer
+	//! \param pDelay ticks from now until the timer fires, at least 1
+	//! \param pValue passed to the fire callback
+	//! \return id used to cancel the timer, never 0
+	TimerId add(uint64_t pDelay, T pValue)
+	{
+		TimerId id = nextId++;
+		uint64_t expires = now + (pDelay > 0 ? pDelay : 1);
+
+		timers.emplace(id, Timer{ expires, std::move(pValue) });
+		place(id, expires);
+		return id;
+	}
+
+	//! Disarm a timer
+	//! \return false if the timer already fired or was cancelled
+	bool cancel(TimerId pId)
+	{
+		return timers.erase(pId) != 0;
+	}
+
+	bool contains(TimerId pId) const
+	{
+		return timers.find(pId) != timers.end();
+	}
+
+	//! Ticks left until a timer fires
+	//! \return 0 if the timer doesn't exist
+	uint64_t remaining(TimerId pId) const
+	{
+		auto it = timers.find(pId);
+		return (it != timers.end() ? it->second.expires - now : 0);
+	}
+
+	//! Ticks until the next timer could fire. This may be earlier than any timer actually
+	//! fires, but never later.
+	//! \return 0 if there are no timers
+	uint64_t nextExpiry() const
+	{
+		if (timers.empty())
+			return 0;
+
+		for (uint64_t delay = 1; delay <= LEVEL0_SIZE; ++delay)
+		{
+			uint64_t tick = now + delay;
+			if (!slots[0][tick & LEVEL0_MASK].empty())
+				return delay;
+
+			// The higher levels are moved down when the first level wraps around.
+			if ((tick & LEVEL0_MASK) == 0)
+				return delay;
+		}
+
+		return LEVEL0_SIZE;
+	}
+
+	uint64_t getTick() const	{ return now; }
+	size_t size() const			{ return timers.size(); }
+	bool empty() const			{ return timers.empty(); }
+
+	//! Advance a single tick, and fire the timers that expire on it
+	//! \param pFire called with the id and value of each timer, timers can be added or cancelled from it
+	template<typename F>
+	void advance(F&& pFire)
+	{
+		++now;
+
+		// Move timers down from the higher levels when the level below wraps around.
+		for (size_t level = 1; level < LEVELS; ++level)
+		{
+			uint64_t shift = LEVEL0_BITS + (level - 1) * LEVELN_BITS;
+			if ((now & ((uint64_t(1) << shift) - 1)) != 0)
+				break;
+
+			cascade(level, (now >> shift) & LEVELN_MASK);
+		}
+
+		auto& slot = slots[0][now & LEVEL0_MASK];
+		if (slot.empty())
+			return;
+
+		std::vector<TimerId> expired;
+		expired.swap(slot);
+
+		for (auto id : expired)
+		{
+			auto it = timers.find(id);
+			if (it == timers.end())
+				continue;
+
+			T value = std::move(it->second.value);
+			timers.erase(it);
+			pFire(id, std::move(value));
+		}
+	}
+
+	void clear()
+	{
+		timers.clear();
+		for (auto& level : slots)
+		{
+			for (auto& slot : level)
+				slot.clear();
+		}
+	}
+
+private:
+	static constexpr uint64_t LEVEL0_BITS = 8;
+	static constexpr uint64_t LEVELN_BITS = 6;
+	static constexpr uint64_t LEVEL0_SIZE = uint64_t(1) << LEVEL0_BITS;
+	static constexpr uint64_t LEVEL0_MASK = LEVEL0_SIZE - 1;
+	static constexpr uint64_t LEVELN_MASK = (uint64_t(1) << LEVELN_BITS) - 1;
+	static constexpr size_t LEVELS = 4;
+
+	// Timers further out than this wait in the last slot, and are placed again when they get there.
+	static constexpr uint64_t MAX_DELAY = (uint64_t(1) << (LEVEL0_BITS + (LEVELS - 1) * LEVELN_BITS)) - 1;
+
+	struct Timer
+	{
+		uint64_t expires;
+		T value;
+	};
+
+	void place(TimerId pId, uint64_t pExpires)
+	{
+		uint64_t delay = pExpires - now;
+		if (delay < LEVEL0_SIZE)
+		{
+			slots[0][pExpires & LEVEL0_MASK].push_back(pId);
+			return;
+		}
+
+		if (delay > MAX_DELAY)
+			pExpires = now + MAX_DELAY;
+
+		for (size_t level = 1; level < LEVELS; ++level)
+		{
+			uint64_t shift = LEVEL0_BITS + level * LEVELN_BITS;
+			if (level == LEVELS - 1 || delay < (uint64_t(1) << shift))
+			{
+				slots[level][(pExpires >> (shift - LEVELN_BITS)) & LEVELN_MASK].push_back(pId);
+				return;
+			}
+		}
+	}
+
+	void cascade(size_t pLevel, uint64_t pSlot)
+	{
+		std::vector<TimerId> moving;
+		moving.swap(slots[pLevel][pSlot]);
+
+		for (auto id : moving)
+		{
+			auto it = timers.find(id);
+			if (it != timers.end())
+				place(id, it->second.expires);
+		}
+	}
+
+	uint64_t now;
+	TimerId nextId;
+	std::unordered_map<TimerId, Timer> timers;
+	std::array<std::array<std::vector<TimerId>, LEVEL0_SIZE>, LEVELS> slots;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef GS2EMU_WAKEUPEVENT_H
+#define GS2EMU_WAKEUPEVENT_H
+
+#include <functional>
+#include "CSocket.h"
+
+//! Lets another thread wake up the main loop. It registers with the socket manager like a
+//! socket, and becomes readable when signal() is called; onRecv() then drains it and runs the
+//! callback on the main thread. Built on eventfd, so it is only valid on linux, elsewhere
+//! callers have to poll for whatever the other thread finished.
+class WakeupEvent : public CSocketStub
+{
+public:
+	//! \param pCallback run from onRecv() after a signal, may be empty
+	explicit WakeupEvent(std::function<void()> pCallback = {});
+	~WakeupEvent();
+
+	// Delete copy and move operations
+	WakeupEvent(const WakeupEvent&) = delete;
+	WakeupEvent& operator=(const WakeupEvent&) = delete;
+	WakeupEvent(WakeupEvent&&) = delete;
+	WakeupEvent& operator=(WakeupEvent&&) = delete;
+
+	//! Whether the event can be signalled, false if the platform has no eventfd
+	bool isValid() const				{ return handle >= 0; }
+
+	//! Wake up the main loop, safe to call from any thread
+	void signal();
+
+	// Required by CSocketStub.
+	bool onRecv() override;
+	bool onSend() override				{ return true; }
+	SOCKET getSocketHandle() override	{ return (SOCKET)handle; }
+	bool canRecv() override				{ return true; }
+	bool canSend() override				{ return false; }
+
+private:
+	int handle;
+	std::function<void()> callback;
+};
+
+#endif
@@ -11,6 +11,9 @@ namespace utilities
 {
 	std::string retokenizeArray(const std::vector<CString>& triggerData, int start_idx = 0);
 	CString retokenizeCStringArray(const std::vector<CString>& triggerData, int start_idx = 0);
+
+	//! Lower case copy of a string, for use as a case-insensitive lookup key
+	std::string foldCase(const CString& str);
 }
 
 #endif
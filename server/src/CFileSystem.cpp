@@ -9,10 +9,14 @@
 	#include <utime.h>
 #endif
 #include <map>
+#include <string_view>
+#include <unordered_set>
 #include "IDebug.h"
 #include "IUtil.h"
 #include "TServer.h"
 #include "CFileSystem.h"
+#include "FileSystemWatcher.h"
+#include "utilities/stringutils.h"
 
 #if defined(_WIN32) || defined(_WIN64)
 	#ifndef __GNUC__ // rain
@@ -22,13 +26,13 @@
 #endif
 
 CFileSystem::CFileSystem()
-: server(nullptr)
+: server(nullptr), watcher(nullptr)
 {
 	m_preventChange = new std::recursive_mutex();
 }
 
 CFileSystem::CFileSystem(TServer* pServer)
-: server(pServer)
+: server(pServer), watcher(nullptr)
 {
 	m_preventChange = new std::recursive_mutex();
 }
@@ -41,16 +45,21 @@ CFileSystem::~CFileSystem()
 
 void CFileSystem::clear()
 {
-	fileList.clear();
+	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+
+	cancelRebuild();
+
+	if (watcher != nullptr)
+		watcher->removeFileSystem(this);
+
+	index.clear();
 	directoryList.clear();
+	baseDirs.clear();
+	queuedDirs.clear();
 }
 
-void CFileSystem::addDir(const CString& dir, const CString& wildcard, bool forceRecursive)
+CFileSystem::DirectorySpec CFileSystem::makeDirectorySpec(const CString& dir, const CString& wildcard, bool forceRecursive) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
-	if (server == nullptr) return;
-
 	// Format the directory.
 	CString newDir(dir);
 	if (newDir[newDir.length() - 1] == '/' || newDir[newDir.length() - 1] == '\\')
@@ -61,16 +70,33 @@ void CFileSystem::addDir(const CString& dir, const CString& wildcard, bool force
 		CFileSystem::fixPathSeparators(newDir);
 	}
 
+	return { server->getServerPath() << newDir << wildcard, forceRecursive || server->getSettings().getBool("nofoldersconfig", false) };
+}
+
+void CFileSystem::addDir(const CString& dir, const CString& wildcard, bool forceRecursive)
+{
+	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+
+	if (server == nullptr) return;
+
+	// A background scan would replace whatever we add now.
+	finishRebuild(true);
+
 	// Add the directory to the directory list.
-	CString ndir = server->getServerPath() << newDir << wildcard;
-	if ( vecSearch<CString>(directoryList, ndir) != -1)	// Already exists?  Resync.
-		resync();
+	auto spec = makeDirectorySpec(dir, wildcard, forceRecursive);
+	if ( vecSearch<CString>(directoryList, spec.path) != -1)	// Already exists?  Resync.
+		resync(watcher != nullptr);
 	else
 	{
-		directoryList.push_back(ndir);
+		directoryList.push_back(spec.path);
+		baseDirs.push_back(spec);
+
+		// Watch for changes before loading, so files created in the meantime aren't missed.
+		if (watcher != nullptr)
+			watcher->addDirectory(this, spec.path, spec.recursive);
 
 		// Load up the files in the directory.
-		loadAllDirectories(ndir, forceRecursive || server->getSettings().getBool("nofoldersconfig", false));
+		loadAllDirectories(spec.path, spec.recursive);
 	}
 }
 
@@ -88,7 +114,73 @@ void CFileSystem::addFile(CString file)
 		directory.removeI(0, server->getServerPath().length());
 
 	// Add to the map.
-	fileList[filename] = server->getServerPath() << directory << filename;
+	CString path = server->getServerPath() << directory << filename;
+	index.add(filename, path);
+
+	if (pendingScan.valid())
+		pendingChanges.push_back({ filename, path, true });
+}
+
+void CFileSystem::addSubDir(const CString& dir)
+{
+	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+
+	// Sub-directories are appended as they are found.
+	std::vector<CString> dirs{ dir };
+	for (size_t i = 0; i < dirs.size(); ++i)
+	{
+		CString ndir = CString() << dirs[i] << "*";
+		if (vecSearch<CString>(directoryList, ndir) != -1)
+			continue;
+
+		directoryList.push_back(ndir);
+		if (watcher != nullptr)
+			watcher->addDirectory(this, ndir, true);
+
+		FileIndex found;
+		scanDirectory(ndir, true, found, dirs);
+		for (const auto& [filename, path] : found.fileList)
+		{
+			index.add(filename, path);
+			if (pendingScan.valid())
+				pendingChanges.push_back({ filename, path, true });
+		}
+	}
+}
+
+void CFileSystem::removeSubDir(const CString& dir)
+{
+	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+
+	std::string_view prefix(dir.text(), dir.length());
+	auto isBelow = [&prefix](const CString& path) { return std::string_view(path.text(), path.length()).starts_with(prefix); };
+
+	for (auto it = directoryList.begin(); it != directoryList.end();)
+	{
+		if (!isBelow(*it))
+		{
+			++it;
+			continue;
+		}
+
+		if (watcher != nullptr)
+			watcher->removeDirectory(this, *it);
+		it = directoryList.erase(it);
+	}
+
+	std::vector<CString> removed;
+	for (const auto& [filename, path] : index.fileList)
+	{
+		if (isBelow(path))
+			removed.push_back(filename);
+	}
+
+	for (const auto& filename : removed)
+	{
+		index.remove(filename);
+		if (pendingScan.valid())
+			pendingChanges.push_back({ filename, {}, false });
+	}
 }
 
 void CFileSystem::removeFile(const CString& file)
@@ -103,50 +195,227 @@ void CFileSystem::removeFile(const CString& file)
 	CFileSystem::fixPathSeparators(directory);
 
 	// Remove it from the map.
-	fileList.erase(filename);
+	index.remove(filename);
+
+	if (pendingScan.valid())
+		pendingChanges.push_back({ filename, {}, false });
 }
 
-void CFileSystem::resync()
+void CFileSystem::resync(bool background)
 {
 	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
 
-	// Clear the file list.
-	fileList.clear();
+	// Only one scan at a time.
+	finishRebuild(true);
 
-	// Iterate through all the directories, reloading their file list.
-	for (const auto & directory : directoryList)
-		loadAllDirectories(directory, server->getSettings().getBool("nofoldersconfig", false));
+	if (background)
+		pendingScan = std::async(std::launch::async, &CFileSystem::scanDirectories, baseDirs);
+	else
+		applyScan(scanDirectories(baseDirs));
 }
 
-CString CFileSystem::find(const CString& file) const
+void CFileSystem::queueDir(const CString& dir, const CString& wildcard, bool forceRecursive)
+{
+	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+
+	if (server == nullptr) return;
+	queuedDirs.push_back(makeDirectorySpec(dir, wildcard, forceRecursive));
+}
+
+void CFileSystem::rebuild()
+{
+	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+
+	finishRebuild(true);
+
+	baseDirs = std::move(queuedDirs);
+	queuedDirs.clear();
+	pendingScan = std::async(std::launch::async, &CFileSystem::scanDirectories, baseDirs);
+}
+
+bool CFileSystem::finishRebuild(bool wait)
 {
 	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
 
-	auto fileIter = fileList.find(file);
-	if ( fileIter == fileList.end()) return {};
+	if (!pendingScan.valid())
+		return false;
+
+	if (!wait && pendingScan.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return false;
+
+	auto result = pendingScan.get();
+
+	// Replay what changed while the scan was running.
+	for (const auto& change : pendingChanges)
+	{
+		if (change.added)
+			result->index.add(change.filename, change.path);
+		else
+			result->index.remove(change.filename);
+	}
+	pendingChanges.clear();
+
+	applyScan(std::move(result));
+	return true;
+}
+
+void CFileSystem::cancelRebuild()
+{
+	if (pendingScan.valid())
+		pendingScan.get();
+	pendingChanges.clear();
+}
+
+void CFileSystem::applyScan(std::unique_ptr<ScanResult> result)
+{
+	std::vector<CString> newDirectoryList;
+	newDirectoryList.reserve(result->directories.size());
+	for (const auto& directory : result->directories)
+		newDirectoryList.push_back(directory.path);
+
+	// Move the watches over to the new directories.
+	if (watcher != nullptr)
+	{
+		for (const auto& directory : directoryList)
+		{
+			if (vecSearch<CString>(newDirectoryList, directory) == -1)
+				watcher->removeDirectory(this, directory);
+		}
+
+		for (const auto& directory : result->directories)
+			watcher->addDirectory(this, directory.path, directory.recursive);
+	}
+
+	// Just swaps the containers, so lookups never wait for a scan.
+	index = std::move(result->index);
+	directoryList = std::move(newDirectoryList);
+}
+
+CString CFileSystem::find(const CString& file) const
+{
+	auto fileIter = index.fileList.find(file);
+	if ( fileIter == index.fileList.end()) return {};
 	return {fileIter->second};
 }
 
 CString CFileSystem::findi(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+	auto foldIter = index.foldedList.find(utilities::foldCase(file));
+	if (foldIter == index.foldedList.end()) return {};
 
-	for (const auto & fileIter : fileList)
-		if (fileIter.first.comparei(file)) return {fileIter.second};
-	return {};
+	auto fileIter = index.fileList.find(foldIter->second.name);
+	if (fileIter == index.fileList.end()) return {};
+	return {fileIter->second};
 }
 
 CString CFileSystem::fileExistsAs(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+	auto foldIter = index.foldedList.find(utilities::foldCase(file));
+	if (foldIter == index.foldedList.end()) return {};
+	return {foldIter->second.name};
+}
 
-	for (const auto & fileIter : fileList)
-		if (fileIter.first.comparei(file)) return {fileIter.first};
-	return {};
+/*
+	CFileSystem::FileIndex
+*/
+void CFileSystem::FileIndex::add(const CString& filename, const CString& path)
+{
+	auto [fileIter, inserted] = fileList.insert_or_assign(filename, path);
+	if (!inserted)
+		return;
+
+	auto [foldIter, added] = foldedList.try_emplace(utilities::foldCase(filename), FoldedName{ filename, 1 });
+	if (!added)
+	{
+		// Keep pointing at whichever name a search of fileList would find first.
+		if (filename < foldIter->second.name)
+			foldIter->second.name = filename;
+		++foldIter->second.count;
+	}
 }
 
-#if (defined(_WIN32) || defined(_WIN64)) && !defined(__GNUC__)
+void CFileSystem::FileIndex::remove(const CString& filename)
+{
+	if (fileList.erase(filename) == 0)
+		return;
+
+	auto foldIter = foldedList.find(utilities::foldCase(filename));
+	if (foldIter == foldedList.end())
+		return;
+
+	if (--foldIter->second.count == 0)
+	{
+		foldedList.erase(foldIter);
+		return;
+	}
+
+	// Another name differing only by case is still around, so point at that instead.
+	if (foldIter->second.name == filename)
+	{
+		for (const auto & fileIter : fileList)
+		{
+			if (fileIter.first.comparei(filename))
+			{
+				foldIter->second.name = fileIter.first;
+				break;
+			}
+		}
+	}
+}
+
+void CFileSystem::FileIndex::clear()
+{
+	fileList.clear();
+	foldedList.clear();
+}
+
+/*
+	Directory scanning
+*/
 void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
+{
+	std::vector<CString> subDirs;
+	scanDirectory(directory, recursive, index, subDirs);
+
+	for (const auto& subDir : subDirs)
+	{
+		CString ndir = CString() << subDir << "*";
+		if (vecSearch<CString>(directoryList, ndir) != -1)
+			continue;
+
+		directoryList.push_back(ndir);
+		if (watcher != nullptr)
+			watcher->addDirectory(this, ndir, true);
+
+		loadAllDirectories(ndir, true);
+	}
+}
+
+std::unique_ptr<CFileSystem::ScanResult> CFileSystem::scanDirectories(std::vector<DirectorySpec> dirs)
+{
+	auto result = std::make_unique<ScanResult>();
+	std::unordered_set<std::string> seen;
+
+	// Sub-directories are appended as they are found.
+	for (size_t i = 0; i < dirs.size(); ++i)
+	{
+		auto spec = dirs[i];
+		if (!seen.insert(spec.path.text()).second)
+			continue;
+
+		result->directories.push_back(spec);
+
+		std::vector<CString> subDirs;
+		scanDirectory(spec.path, spec.recursive, result->index, subDirs);
+		for (const auto& subDir : subDirs)
+			dirs.push_back({ CString() << subDir << "*", true });
+	}
+
+	return result;
+}
+
+#if (defined(_WIN32) || defined(_WIN64)) && !defined(__GNUC__)
+void CFileSystem::scanDirectory(const CString& directory, bool recursive, FileIndex& pIndex, std::vector<CString>& subDirs)
 {
 	CString dir = CString() << directory.remove(directory.findl(fSep)) << fSep;
 	WIN32_FIND_DATAA filedata;
@@ -158,26 +427,22 @@ void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
 		{
 			if (filedata.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 			{
+				// We need to add the directory to the directory list.
 				if (filedata.cFileName[0] != '.' && recursive)
-				{
-					// We need to add the directory to the directory list.
-					CString newDir = CString() << dir << filedata.cFileName << fSep;
-					newDir.removeI(0, server->getServerPath().length());
-					addDir(newDir, "*", true);
-				}
+					subDirs.push_back(CString() << dir << filedata.cFileName << fSep);
 			}
 			else
 			{
 				// Grab the file name.
 				CString file((char *)filedata.cFileName);
-				fileList[file] = CString(dir) << filedata.cFileName;
+				pIndex.add(file, CString(dir) << filedata.cFileName);
 			}
 		} while (FindNextFileA(hFind, &filedata));
 	}
 	FindClose(hFind);
 }
 #else
-void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
+void CFileSystem::scanDirectory(const CString& directory, bool recursive, FileIndex& pIndex, std::vector<CString>& subDirs)
 {
 	CString path = CString() << directory.remove(directory.findl(fSep)) << fSep;
 	CString wildcard = directory.subString(directory.findl(fSep) + 1);
@@ -198,13 +463,9 @@ void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
 			stat(dircheck.text(), &statx);
 			if ((statx.st_mode & S_IFDIR))
 			{
+				// We need to add the directory to the directory list.
 				if (recursive)
-				{
-					// We need to add the directory to the directory list.
-					CString newDir = CString() << path << ent->d_name << fSep;
-					newDir.removeI(0, server->getServerPath().length());
-					addDir(newDir, "*", true);
-				}
+					subDirs.push_back(CString() << path << ent->d_name << fSep);
 				continue;
 			}
 		}
@@ -213,7 +474,7 @@ void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
 		// Grab the file name.
 		CString file(ent->d_name);
 		if (file.match(wildcard))
-			fileList[file] = CString(path) << file;
+			pIndex.add(file, CString(path) << file);
 	}
 	closedir(dir);
 }
@@ -221,8 +482,6 @@ void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
 
 CString CFileSystem::load(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return CString();
@@ -236,8 +495,6 @@ CString CFileSystem::load(const CString& file) const
 
 time_t CFileSystem::getModTime(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return 0;
@@ -250,8 +507,6 @@ time_t CFileSystem::getModTime(const CString& file) const
 
 bool CFileSystem::setModTime(const CString& file, time_t modTime) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return false;
@@ -267,8 +522,6 @@ bool CFileSystem::setModTime(const CString& file, time_t modTime) const
 
 int CFileSystem::getFileSize(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return 0;
@@ -281,8 +534,6 @@ int CFileSystem::getFileSize(const CString& file) const
 
 CString CFileSystem::getDirByExtension(const std::string &extension) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	for (const auto& directory : directoryList) {
 		if (getExtension(directory) == extension) {
 			return { getPath(directory) };
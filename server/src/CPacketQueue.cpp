@@ -0,0 +1,521 @@
+#include <algorithm>
+
+#include "IDebug.h"
+#include "IEnums.h"
+#include "CPacketQueue.h"
+
+// Maximum amount of packet data combined into a single frame.
+// Frame lengths are sent as a short, so leave some room for compression overhead.
+static constexpr int MAX_FRAME_DATA = 0xF000;
+
+SharedPacket makeSharedPacket(CString pPacket, bool appendNL)
+{
+	// empty buffer?
+	if (pPacket.isEmpty())
+		return nullptr;
+
+	// append '\n'
+	if (appendNL)
+	{
+		if (pPacket[pPacket.length()-1] != '\n')
+			pPacket.writeChar('\n');
+	}
+
+	return std::make_shared<const CString>(std::move(pPacket));
+}
+
+// A PLO_RAWDATA header on its own, which means the next packet is its payload.
+// The header is GChar encoded, so the first newline is always the end of the header.
+static bool isRawDataHeader(const CString& pPacket)
+{
+	if (pPacket.length() == 0 || (unsigned char)pPacket.text()[0] - 32 != PLO_RAWDATA)
+		return false;
+
+	return pPacket.find("\n") == pPacket.length() - 1;
+}
+
+static bool isFilePacket(const CString& pPacket)
+{
+	switch ((unsigned char)pPacket.text()[0] - 32)
+	{
+		case PLO_RAWDATA:
+		case PLO_BOARDPACKET:
+		case PLO_FILE:
+		case PLO_LARGEFILESTART:
+		case PLO_LARGEFILESIZE:
+		case PLO_LARGEFILEEND:
+			return true;
+		default:
+			return false;
+	}
+}
+
+CPacketQueue::CPacketQueue(CSocket* pSocket)
+	: sock(pSocket), frameCache(nullptr), limits(nullptr), rawPending(false), fileDeferred(false),
+	released(false), budget(0), tickStart(OutboundLimits::clock::now())
+{
+	out_codec.setGen(ENCRYPT_GEN_2);
+}
+
+void CPacketQueue::setLimits(OutboundLimits* pLimits)
+{
+	limits = pLimits;
+
+	// Start with a full tick, so a new connection can send file data right away.
+	budget = (limits != nullptr ? limits->bytesPerTick : 0);
+	tickStart = OutboundLimits::clock::now();
+}
+
+void CPacketQueue::setCodec(int pGen, int pKey)
+{
+	out_codec.setGen(pGen);
+	out_codec.reset(pKey);
+}
+
+void CPacketQueue::addPacket(CString pPacket)
+{
+	if (pPacket.isEmpty())
+		return;
+
+	addPacket(std::make_shared<const CString>(std::move(pPacket)));
+}
+
+void CPacketQueue::addPacket(const SharedPacket& pPacket, bool pBroadcast)
+{
+	if (!pPacket || pPacket->isEmpty())
+		return;
+
+	// The payload of a raw data header has to follow it directly.
+	if (rawPending)
+	{
+		fileBuffer.push_back({ pPacket, nullptr, nullptr });
+		rawPending = false;
+		return;
+	}
+
+	if (isFilePacket(*pPacket))
+	{
+		fileBuffer.push_back({ pPacket, nullptr, nullptr });
+		rawPending = isRawDataHeader(*pPacket);
+	}
+	else
+	{
+		gameplayBuffer.push_back({ pPacket, pBroadcast });
+		if (!canSendGameplay())
+			limits->flushPending = true;
+	}
+}
+
+void CPacketQueue::addStream(std::unique_ptr<PacketStream> pStream)
+{
+	if (pStream)
+		fileBuffer.push_back({ nullptr, std::move(pStream), nullptr });
+}
+
+void CPacketQueue::addFrame(std::shared_ptr<const PrecompressedFrame> pFrame)
+{
+	if (pFrame)
+		fileBuffer.push_back({ nullptr, nullptr, std::move(pFrame) });
+}
+
+bool CPacketQueue::canSend() const
+{
+	if (!oBuffer.empty())
+		return true;
+
+	if (canSendGameplay() && !gameplayBuffer.empty())
+		return true;
+
+	return !fileBuffer.empty() && canSendFile();
+}
+
+bool CPacketQueue::canSendGameplay() const
+{
+	return limits == nullptr || released;
+}
+
+bool CPacketQueue::canSendFile() const
+{
+	if (limits == nullptr || limits->bytesPerTick <= 0 || budget > 0)
+		return true;
+
+	// See if enough ticks have passed to pay off what the last chunk went over by.
+	auto now = OutboundLimits::clock::now();
+	long long ticks = (now - tickStart) / limits->tick;
+	return budget + ticks * limits->bytesPerTick > 0;
+}
+
+OutboundLimits::clock::time_point CPacketQueue::nextSendTime() const
+{
+	if (fileBuffer.empty() || canSendFile())
+		return OutboundLimits::clock::time_point::max();
+
+	// Enough ticks to pay off what the last chunk went over by.
+	long long needed = -budget / limits->bytesPerTick + 1;
+	return tickStart + needed * limits->tick;
+}
+
+void CPacketQueue::refillBudget()
+{
+	// Unused budget doesn't carry over past a single tick.
+	auto now = OutboundLimits::clock::now();
+	long long ticks = (now - tickStart) / limits->tick;
+	if (ticks > 0)
+	{
+		tickStart += ticks * limits->tick;
+		budget = (int)std::min<long long>(budget + ticks * limits->bytesPerTick, limits->bytesPerTick);
+	}
+}
+
+void CPacketQueue::spendBudget(int pBytes, bool pFile)
+{
+	if (limits == nullptr || limits->bytesPerTick <= 0 || pBytes <= 0)
+		return;
+
+	refillBudget();
+
+	// Gameplay packets always go out, but only use up the part of the budget that isn't kept for files.
+	if (pFile)
+		budget -= pBytes;
+	else
+	{
+		int reserved = std::min(limits->fileBytesPerTick, limits->bytesPerTick);
+		if (budget > reserved)
+			budget = std::max(reserved, budget - pBytes);
+	}
+}
+
+void CPacketQueue::clearBuffers()
+{
+	gameplayBuffer.clear();
+	fileBuffer.clear();
+	rawPending = false;
+	fileDeferred = false;
+	released = false;
+	oBuffer.clear();
+}
+
+bool CPacketQueue::expandFileStream()
+{
+	// Replace a stream at the front with its next packets, dropping it once it runs out.
+	while (!fileBuffer.empty() && fileBuffer.front().stream)
+	{
+		std::vector<SharedPacket> packets;
+		if (!fileBuffer.front().stream->next(packets))
+		{
+			fileBuffer.pop_front();
+			continue;
+		}
+
+		for (auto it = packets.rbegin(); it != packets.rend(); ++it)
+		{
+			if (*it && !(*it)->isEmpty())
+				fileBuffer.push_front({ std::move(*it), nullptr, nullptr });
+		}
+	}
+
+	return !fileBuffer.empty();
+}
+
+bool CPacketQueue::addFileChunk(std::vector<SharedPacket>& pFrame, int& pFrameLength)
+{
+	if (!expandFileStream())
+		return true;
+
+	// Precompressed frames can't be combined with other packets, so leave it for the next frame.
+	if (fileBuffer.front().frame)
+		return false;
+
+	// Wait for the payload if we only have the raw data header so far.
+	size_t count = (isRawDataHeader(*fileBuffer.front().data) ? 2 : 1);
+	if (fileBuffer.size() < count || !fileBuffer[count - 1].data)
+		return true;
+
+	int len = 0;
+	for (size_t i = 0; i < count; ++i)
+		len += fileBuffer[i].data->length();
+
+	if (pFrameLength > 0 && pFrameLength + len > MAX_FRAME_DATA)
+		return false;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		pFrame.push_back(std::move(fileBuffer.front().data));
+		fileBuffer.pop_front();
+	}
+
+	pFrameLength += len;
+	return true;
+}
+
+std::shared_ptr<const PrecompressedFrame> CPacketQueue::takePrecompressedFrame()
+{
+	// Only when it is the file lane's turn, the same as a regular file chunk.
+	if (!fileDeferred && canSendGameplay() && !gameplayBuffer.empty())
+		return nullptr;
+
+	if (!canSendFile() || !expandFileStream() || !fileBuffer.front().frame)
+		return nullptr;
+
+	auto frame = std::move(fileBuffer.front().frame);
+	fileBuffer.pop_front();
+	fileDeferred = false;
+	return frame;
+}
+
+bool CPacketQueue::takeNormalPackets(std::deque<QueuedPacket>& pBuffer, std::vector<SharedPacket>& pFrame, int& pFrameLength, bool& pBroadcastOnly)
+{
+	while (!pBuffer.empty())
+	{
+		auto& packet = pBuffer.front();
+		if (pFrameLength > 0 && pFrameLength + packet.data->length() > MAX_FRAME_DATA)
+			return false;
+
+		pFrameLength += packet.data->length();
+		pBroadcastOnly = pBroadcastOnly && packet.broadcast;
+		pFrame.push_back(std::move(packet.data));
+		pBuffer.pop_front();
+	}
+
+	return true;
+}
+
+std::vector<SharedPacket> CPacketQueue::takeFramePackets(bool& pBroadcastOnly, int& pGameplayLength, int& pFileLength)
+{
+	std::vector<SharedPacket> frame;
+	int frameLength = 0;
+	pBroadcastOnly = true;
+	pGameplayLength = 0;
+
+	// A file chunk that didn't fit last time goes first, so gameplay packets can't starve a download.
+	bool fileSent = false;
+	if (fileDeferred && canSendFile())
+	{
+		addFileChunk(frame, frameLength);
+		fileDeferred = false;
+		fileSent = true;
+		pBroadcastOnly = false;
+	}
+	pFileLength = frameLength;
+
+	// Gameplay packets, in the order they were queued.  Once they are all sent, hold the next ones until the next flush.
+	if (canSendGameplay())
+	{
+		bool allTaken = takeNormalPackets(gameplayBuffer, frame, frameLength, pBroadcastOnly);
+		pGameplayLength = frameLength - pFileLength;
+		if (!allTaken)
+			return frame;
+		released = false;
+	}
+
+	// Then a single file chunk, with its raw data header, if there is budget left for it.
+	if (!fileSent && canSendFile())
+	{
+		size_t count = frame.size();
+		fileDeferred = !addFileChunk(frame, frameLength);
+		if (frame.size() != count)
+			pBroadcastOnly = false;
+		pFileLength = frameLength - pGameplayLength;
+	}
+
+	return frame;
+}
+
+int CPacketQueue::compressFrame(CString& pSend)
+{
+	switch (out_codec.getGen())
+	{
+		// Gen 1 is not encrypted or compressed.
+		case ENCRYPT_GEN_1:
+			return COMPRESS_UNCOMPRESSED;
+
+		// Gen 2 and 3 are zlib compressed.
+		case ENCRYPT_GEN_2:
+		case ENCRYPT_GEN_3:
+			pSend.zcompressI();
+			return COMPRESS_ZLIB;
+
+		// Gen 4 is bz2 compressed.
+		case ENCRYPT_GEN_4:
+			pSend.bzcompressI();
+			return COMPRESS_BZ2;
+
+		// Gen 5 picks the compression by size.
+		default:
+			if (pSend.length() > 0x2000)
+			{
+				pSend.bzcompressI();
+				return COMPRESS_BZ2;
+			}
+			else if (pSend.length() > 55)
+			{
+				pSend.zcompressI();
+				return COMPRESS_ZLIB;
+			}
+			return COMPRESS_UNCOMPRESSED;
+	}
+}
+
+int CPacketQueue::selectFrameData(const PrecompressedFrame& pFrame, CString& pSend) const
+{
+	// Same choices as compressFrame().
+	switch (out_codec.getGen())
+	{
+		case ENCRYPT_GEN_1:
+			pSend = pFrame.zlib;
+			pSend.zuncompressI();
+			return COMPRESS_UNCOMPRESSED;
+
+		case ENCRYPT_GEN_2:
+		case ENCRYPT_GEN_3:
+			pSend = pFrame.zlib;
+			return COMPRESS_ZLIB;
+
+		case ENCRYPT_GEN_4:
+			pSend = pFrame.bz2;
+			return COMPRESS_BZ2;
+
+		default:
+			if (pFrame.length > 0x2000)
+			{
+				pSend = pFrame.bz2;
+				return COMPRESS_BZ2;
+			}
+			else if (pFrame.length > 55)
+			{
+				pSend = pFrame.zlib;
+				return COMPRESS_ZLIB;
+			}
+			pSend = pFrame.zlib;
+			pSend.zuncompressI();
+			return COMPRESS_UNCOMPRESSED;
+	}
+}
+
+void CPacketQueue::appendFrame(CString& pSend, int pCompressionType)
+{
+	CString frame;
+
+	switch (out_codec.getGen())
+	{
+		case ENCRYPT_GEN_1:
+		case ENCRYPT_GEN_2:
+		case ENCRYPT_GEN_3:
+			frame.writeShort(pSend.length());
+			break;
+
+		// Gen 4 encrypts the compressed data.
+		case ENCRYPT_GEN_4:
+			out_codec.limitFromType(COMPRESS_BZ2);
+			out_codec.encrypt(pSend);
+			frame.writeShort(pSend.length());
+			break;
+
+		// Gen 5 sends the compression type before the encrypted data.
+		default:
+			out_codec.limitFromType(pCompressionType);
+			out_codec.encrypt(pSend);
+			frame.writeShort(pSend.length() + 1);
+			frame.writeChar((char)pCompressionType);
+			break;
+	}
+
+	oBuffer.write(frame.text(), frame.length());
+	oBuffer.write(pSend.text(), pSend.length());
+}
+
+void CPacketQueue::flush()
+{
+	if (sock == nullptr || oBuffer.empty())
+		return;
+
+	unsigned int dsize = (unsigned int)oBuffer.length();
+	int sent = sock->sendData((char*)oBuffer.data(), &dsize);
+	if (sent > 0)
+		oBuffer.consume(sent);
+}
+
+void CPacketQueue::sendCompress()
+{
+	// Don't build more frames while the socket is still behind, the packets can
+	// keep waiting in the queue until it catches up.
+	if (oBuffer.empty())
+	{
+		// Precompressed file data only needs to be encrypted.
+		if (auto frame = takePrecompressedFrame(); frame)
+		{
+			CString pSend;
+			int compressionType = selectFrameData(*frame, pSend);
+			appendFrame(pSend, compressionType);
+			spendBudget(frame->length, true);
+			flush();
+			return;
+		}
+
+		bool broadcastOnly;
+		int gameplayLength = 0, fileLength = 0;
+		auto packets = takeFramePackets(broadcastOnly, gameplayLength, fileLength);
+		if (!packets.empty())
+		{
+			spendBudget(gameplayLength, false);
+			spendBudget(fileLength, true);
+
+			int gen = out_codec.getGen();
+			int compressionType = COMPRESS_UNCOMPRESSED;
+
+			// Frames made up only of broadcast packets are usually identical for every player
+			// that receives them, so they only have to be compressed once.
+			bool useCache = (frameCache != nullptr && broadcastOnly && gen != ENCRYPT_GEN_1);
+			const CString* cached = (useCache ? frameCache->find(gen, packets, compressionType) : nullptr);
+
+			CString pSend;
+			if (cached != nullptr)
+				pSend = *cached;
+			else
+			{
+				for (const auto& packet : packets)
+					pSend << *packet;
+
+				compressionType = compressFrame(pSend);
+				if (useCache)
+					frameCache->add(gen, std::move(packets), pSend, compressionType);
+			}
+
+			appendFrame(pSend, compressionType);
+		}
+	}
+
+	flush();
+}
+
+/*
+	BroadcastFrameCache
+*/
+size_t BroadcastFrameCache::hashPackets(int pGen, const std::vector<SharedPacket>& pPackets)
+{
+	size_t hash = std::hash<int>{}(pGen);
+	for (const auto& packet : pPackets)
+		hash ^= std::hash<const CString*>{}(packet.get()) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+const CString* BroadcastFrameCache::find(int pGen, const std::vector<SharedPacket>& pPackets, int& pCompressionType) const
+{
+	auto range = frames.equal_range(hashPackets(pGen, pPackets));
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second.gen == pGen && it->second.packets == pPackets)
+		{
+			pCompressionType = it->second.compressionType;
+			return &it->second.data;
+		}
+	}
+
+	return nullptr;
+}
+
+void BroadcastFrameCache::add(int pGen, std::vector<SharedPacket> pPackets, const CString& pData, int pCompressionType)
+{
+	size_t hash = hashPackets(pGen, pPackets);
+	frames.emplace(hash, CachedFrame{ pGen, pCompressionType, std::move(pPackets), pData });
+}
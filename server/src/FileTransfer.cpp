@@ -0,0 +1,166 @@
+#include <chrono>
+
+#include "IEnums.h"
+#include "IUtil.h"
+#include "FileTransfer.h"
+
+// Files that are compressed at the same time, so a patch day doesn't take every core.
+static constexpr size_t MAX_BUILDS = 2;
+
+/*
+	FileSendStream
+*/
+FileSendStream::FileSendStream(std::shared_ptr<const CachedFile> pFile, const CString& pName, int pPacketLength, int pChunkSize, bool pSendModTime)
+	: file(std::move(pFile)), name(pName), packetLength(pPacketLength), chunkSize(pChunkSize), sendModTime(pSendModTime), offset(0)
+{
+}
+
+bool FileSendStream::next(std::vector<SharedPacket>& pPackets)
+{
+	const CString& fileData = file->data;
+	if (offset >= fileData.length())
+		return false;
+
+	int sendSize = clip(chunkSize, 0, fileData.length() - offset);
+
+	// Older client versions didn't send the modTime.
+	if (!sendModTime)
+	{
+		// We don't add a \n to the end of the packet, so subtract 1 from the packet length.
+		pPackets.push_back(makeSharedPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength - 1 + sendSize)));
+		pPackets.push_back(makeSharedPacket(CString() >> (char)PLO_FILE >> (char)name.length() << name << fileData.subString(offset, sendSize), false));
+	}
+	else
+	{
+		pPackets.push_back(makeSharedPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength + sendSize)));
+		pPackets.push_back(makeSharedPacket(CString() >> (char)PLO_FILE >> (long long)file->modTime >> (char)name.length() << name << fileData.subString(offset, sendSize) << "\n", false));
+	}
+
+	offset += sendSize;
+	return true;
+}
+
+/*
+	PrecompressedFileStore
+*/
+PrecompressedFileStore::PrecompressedFileStore(size_t pMaxBytes, int pMinSize)
+	: maxBytes(pMaxBytes), cachedBytes(0), minSize(pMinSize)
+{
+}
+
+std::shared_ptr<const PrecompressedFile> PrecompressedFileStore::find(const CString& pName, const std::shared_ptr<const CachedFile>& pFile, uint32_t pChecksum)
+{
+	// Compressed copies of files this big would push everything else out.
+	size_t length = pFile->data.length();
+	if (length < (size_t)minSize || length > maxBytes / 4)
+		return nullptr;
+
+	std::string key(pName.text(), pName.length());
+	if (auto it = entries.find(key); it != entries.end())
+	{
+		auto entry = it->second;
+		const auto& file = entry->file;
+		if (file->checksum == pChecksum && file->size == (long long)length && file->modTime == pFile->modTime)
+		{
+			lru.splice(lru.begin(), lru, entry);
+			return file;
+		}
+
+		// The file changed.
+		erase(entry);
+	}
+
+	// If an older version of the file is still compressing, it gets replaced on the next request after it finishes.
+	if (builds.size() < MAX_BUILDS && builds.find(key) == builds.end())
+		builds.emplace(std::move(key), std::async(std::launch::async, &PrecompressedFileStore::build, pFile, pName, pChecksum));
+
+	return nullptr;
+}
+
+void PrecompressedFileStore::update()
+{
+	for (auto it = builds.begin(); it != builds.end();)
+	{
+		if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		auto file = it->second.get();
+		if (auto entry = entries.find(it->first); entry != entries.end())
+			erase(entry->second);
+
+		if (file->bytes <= maxBytes / 4)
+		{
+			lru.push_front(Entry{ it->first, std::move(file) });
+			entries[lru.front().name] = lru.begin();
+			cachedBytes += lru.front().file->bytes;
+		}
+
+		it = builds.erase(it);
+	}
+
+	evict();
+}
+
+void PrecompressedFileStore::setMaxBytes(size_t pMaxBytes)
+{
+	maxBytes = pMaxBytes;
+	evict();
+}
+
+void PrecompressedFileStore::clear()
+{
+	lru.clear();
+	entries.clear();
+	cachedBytes = 0;
+}
+
+std::shared_ptr<const PrecompressedFile> PrecompressedFileStore::build(std::shared_ptr<const CachedFile> pFile, CString pName, uint32_t pChecksum)
+{
+	auto file = std::make_shared<PrecompressedFile>();
+	file->checksum = pChecksum;
+	file->size = pFile->data.length();
+	file->modTime = pFile->modTime;
+	file->bytes = 0;
+
+	// Build the same packets a client that supports large files gets.
+	// 1 (PLO_FILE) + 5 (modTime) + 1 (file.length()) + file.length() + 1 (\n)
+	int packetLength = 1 + 5 + 1 + pName.length() + 1;
+	FileSendStream stream(pFile, pName, packetLength, FILE_CHUNK_SIZE, true);
+
+	std::vector<SharedPacket> packets;
+	while (stream.next(packets))
+	{
+		CString data;
+		for (const auto& packet : packets)
+			data << *packet;
+		packets.clear();
+
+		PrecompressedFrame frame;
+		frame.length = data.length();
+		frame.zlib = data;
+		frame.zlib.zcompressI();
+		frame.bz2 = std::move(data);
+		frame.bz2.bzcompressI();
+
+		file->bytes += frame.zlib.length() + frame.bz2.length();
+		file->frames.push_back(std::move(frame));
+	}
+
+	return file;
+}
+
+void PrecompressedFileStore::erase(std::list<Entry>::iterator pEntry)
+{
+	cachedBytes -= pEntry->file->bytes;
+	entries.erase(pEntry->name);
+	lru.erase(pEntry);
+}
+
+void PrecompressedFileStore::evict()
+{
+	while (cachedBytes > maxBytes && !lru.empty())
+		erase(std::prev(lru.end()));
+}
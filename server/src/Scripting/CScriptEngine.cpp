@@ -1,6 +1,8 @@
 #ifdef V8NPCSERVER
 
 #include "CScriptEngine.h"
+#include "Crc32.h"
+#include "main.h"
 #include "TNPC.h"
 #include "TPlayer.h"
 #include "TServer.h"
@@ -24,7 +26,7 @@ extern void bindClass_Weapon(CScriptEngine *scriptEngine);
 
 CScriptEngine::CScriptEngine(TServer *server)
 	: _server(server), _env(nullptr), _bootstrapFunction(nullptr), _environmentObject(nullptr), _serverObject(nullptr)
-	, _scriptIsRunning(false), _scriptWatcherRunning(false), _scriptWatcherThread()
+	, _scriptIsRunning(false), _scriptWatcherRunning(false), _scriptWatcherThread(), _tickBudget(0)
 {
 	accumulator = std::chrono::nanoseconds(0);
 	lastScriptTimer = std::chrono::high_resolution_clock::now();
@@ -46,10 +48,97 @@ bool CScriptEngine::Initialize()
 	// bootstrap file print
 	SCRIPTENV_D("---START SCRIPT---\n%s\n---END SCRIPT\n\n", bootstrapScript.text());
 
+	auto& settings = _server->getSettings();
+
 	// TODO(joey): Clean this the fuck up
-	_env = new V8ScriptEnv();
-	_env->Initialize();
+	auto v8env = new V8ScriptEnv();
+	v8env->SetExternalReferences(getExternalReferences());
+
+	// The snapshot built by the v8snapshot target has the classes bound and the bootstrap compiled already
+	if (settings.getBool("scriptsnapshot", true))
+		v8env->SetStartupSnapshot(loadSnapshot(bootstrapScript));
+
+	v8env->Initialize();
+	_env = v8env;
+
+	// Keep compiled scripts on disk, so unchanged scripts skip compiling on the next start
+	if (settings.getBool("scriptcodecache", true))
+	{
+		v8env->SetCodeCache(std::make_unique<V8CodeCache>((CString() << _server->getServerPath() << "scriptcache/").text(),
+			std::chrono::hours(24 * std::max(settings.getInt("scriptcachedays", 30), 0))));
+	}
+
+	if (v8env->HasStartupSnapshot())
+		_bootstrapFunction = v8env->GetSnapshotBootstrap();
+	else
+	{
+		bindClasses();
+
+		// Create a new context (occurs on initial compile)
+		_bootstrapFunction = _env->Compile("bootstrap", bootstrapScript.text());
+	}
+	assert(_bootstrapFunction);
+
+	// Bind the server into two separate objects
+	_environmentObject = ScriptFactory::WrapObject(_env, "environment", _server);
+	_serverObject = ScriptFactory::WrapObject(_env, "server", _server);
+
+	// Execute the bootstrap function
+	_env->CallFunctionInScope([&]() -> void {
+		IScriptArguments *args = ScriptFactory::CreateArguments(_env, _environmentObject.get());
+		args->Invoke(_bootstrapFunction);
+		delete args;
+	});
+
+	_scriptWatcherRunning.store(true);
+	_scriptWatcherThread = std::thread(&CScriptEngine::ScriptWatcher, this);
+
+	// Http requests made by scripts
+	_httpRequests = std::make_unique<HttpRequestPool>(
+		(size_t)std::max(settings.getInt("httpthreads", 4), 1),
+		(size_t)std::max(settings.getInt("httpmaxrequests", 64), 1),
+		std::chrono::seconds(std::max(settings.getInt("httptimeout", 10), 1)));
+
+	// Finished requests wake up the main loop through the socket manager
+	if (_httpRequests->getWakeupSocket())
+		_server->getSocketManager().registerSocket(_httpRequests->getWakeupSocket());
+
+	// Time queued events may take per pass of the main loop, 0 runs them all
+	_tickBudget = std::chrono::milliseconds(std::max(settings.getInt("scripttickbudget", 25), 0));
+
+	return true;
+}
+
+bool CScriptEngine::BuildSnapshot(const std::string& path)
+{
+	CString bootstrapScript;
+	bootstrapScript.write((const char *)JSBOOTSTRAPSCRIPT, JSBOOTSTRAPSCRIPT_SIZE);
+
+	// Bind everything the same way Initialize() does, into an isolate that can be snapshotted
+	CScriptEngine engine(nullptr);
+	auto v8env = new V8ScriptEnv();
+	v8env->SetExternalReferences(engine.getExternalReferences());
+	v8env->EnableSnapshotCreation();
+	v8env->Initialize();
+	engine._env = v8env;
+
+	engine.bindClasses();
+
+	std::unique_ptr<IScriptFunction> bootstrap(engine._env->Compile("bootstrap", bootstrapScript.text()));
+	if (!bootstrap)
+		return false;
+
+	V8Snapshot snapshot{};
+	snapshot.bootstrapChecksum = utilities::crc32(bootstrapScript);
+	snapshot.bindingsChecksum = getV8BindingsChecksum();
+	if (!v8env->CreateSnapshot(snapshot, std::move(bootstrap)))
+		return false;
+
+	return snapshot.save(path);
+}
 
+void CScriptEngine::bindClasses()
+{
 	_env->CallFunctionInScope([&]() -> void {
 		CScriptEngine *engine = this;
 
@@ -67,26 +156,38 @@ bool CScriptEngine::Initialize()
 		bindClass_Player(engine);
 		bindClass_Weapon(engine);
 	});
+}
 
-	// Create a new context (occurs on initial compile)
-	_bootstrapFunction = _env->Compile("bootstrap", bootstrapScript.text());
-	assert(_bootstrapFunction);
+std::vector<intptr_t> CScriptEngine::getExternalReferences() const
+{
+	// The bound templates carry the engine as their data, so it is a reference too
+	std::vector<intptr_t> references{ reinterpret_cast<intptr_t>(this) };
 
-	// Bind the server into two separate objects
-	_environmentObject = ScriptFactory::WrapObject(_env, "environment", _server);
-	_serverObject = ScriptFactory::WrapObject(_env, "server", _server);
+	auto callbacks = getV8CallbackReferences();
+	references.insert(references.end(), callbacks.begin(), callbacks.end());
+	return references;
+}
 
-	// Execute the bootstrap function
-	_env->CallFunctionInScope([&]() -> void {
-		IScriptArguments *args = ScriptFactory::CreateArguments(_env, _environmentObject.get());
-		args->Invoke(_bootstrapFunction);
-		delete args;
-	});
+std::unique_ptr<V8Snapshot> CScriptEngine::loadSnapshot(const CString& bootstrapScript) const
+{
+	auto snapshot = std::make_unique<V8Snapshot>();
+	if (!snapshot->load(getBaseHomePath() + V8SNAPSHOT_FILE))
+		return nullptr;
 
-	_scriptWatcherRunning.store(true);
-	_scriptWatcherThread = std::thread(&CScriptEngine::ScriptWatcher, this);
+	if (snapshot->bootstrapChecksum != utilities::crc32(bootstrapScript))
+	{
+		_server->getServerLog().out("[%s] ** [Warning] %s was built from another bootstrap script, rebuild it with the v8snapshot target.\n", _server->getName().text(), V8SNAPSHOT_FILE);
+		return nullptr;
+	}
 
-	return true;
+	// The classes in the snapshot were bound by the code it was built from, which may not match ours.
+	if (snapshot->bindingsChecksum != getV8BindingsChecksum())
+	{
+		_server->getServerLog().out("[%s] ** [Warning] %s was built from other script bindings, rebuild it with the v8snapshot target.\n", _server->getName().text(), V8SNAPSHOT_FILE);
+		return nullptr;
+	}
+
+	return snapshot;
 }
 
 void CScriptEngine::ScriptWatcher()
@@ -127,10 +228,18 @@ void CScriptEngine::Cleanup(bool shutDown)
 	if (_scriptWatcherThread.joinable())
 		_scriptWatcherThread.join();
 
+	// Pending http requests hold on to script handles, so drop them before the environment goes.
+	if (_httpRequests && _httpRequests->getWakeupSocket())
+		_server->getSocketManager().unregisterSocket(_httpRequests->getWakeupSocket());
+	_httpRequests.reset();
+
 	// Clear any registered scripts
 	_updateNpcs.clear();
-	_updateNpcsTimer.clear();
+	for (auto& queue : _npcQueues)
+		queue.clear();
+	_timers.clear();
 	_updateWeapons.clear();
+	_weaponQueue.clear();
 
 	// Remove any registered callbacks
 	for (auto & _callback : _callbacks) {
@@ -140,9 +249,11 @@ void CScriptEngine::Cleanup(bool shutDown)
 
 	// Remove cached scripts
 	for (auto & _cachedScript : _cachedScripts) {
-		delete _cachedScript.second;
+		delete _cachedScript.second.function;
 	}
 	_cachedScripts.clear();
+	_cacheStats.entries = 0;
+	_cacheStats.sourceBytes = 0;
 
 	// Remove bootstrap function
 	if (_bootstrapFunction) {
@@ -172,14 +283,20 @@ IScriptFunction * CScriptEngine::CompileCache(const std::string& code, bool refe
 	// TODO(joey): Temporary naming conventions, maybe pass an optional reference to an object which holds info for the compiler (name, ignore wrap code based off spaces/lines, and execution results?)
 	static int SCRIPT_ID = 1;
 
-	auto scriptFunctionIter = _cachedScripts.find(code);
+	auto scriptFunctionIter = findCachedScript(code);
 	if (scriptFunctionIter != _cachedScripts.end())
 	{
+		_cacheStats.hits++;
+		_cacheStats.reusedBytes += code.length();
+
+		IScriptFunction *scriptFunction = scriptFunctionIter->second.function;
 		if (referenceCount)
-			scriptFunctionIter->second->increaseReference();
-		return scriptFunctionIter->second;
+			scriptFunction->increaseReference();
+		return scriptFunction;
 	}
 
+	_cacheStats.misses++;
+
 	// Compile script, send errors to server
 	SCRIPTENV_D("Compiling script:\n---\n%s\n---\n", code.c_str());
 
@@ -196,21 +313,37 @@ IScriptFunction * CScriptEngine::CompileCache(const std::string& code, bool refe
 	// Increase reference count to compiled script, and cache it.
 	if (referenceCount)
 		compiledScript->increaseReference();
-	_cachedScripts[code] = compiledScript;
+	_cachedScripts.emplace(utilities::contentHash(code), CachedScript{ compiledScript, code });
+	_cacheStats.entries = _cachedScripts.size();
+	_cacheStats.sourceBytes += code.length();
 	return compiledScript;
 }
 
+CScriptEngine::ScriptCache::iterator CScriptEngine::findCachedScript(const std::string& code)
+{
+	auto [it, end] = _cachedScripts.equal_range(utilities::contentHash(code));
+	for (; it != end; ++it)
+	{
+		if (it->second.source == code)
+			return it;
+	}
+
+	return _cachedScripts.end();
+}
+
 bool CScriptEngine::ClearCache(const std::string& code)
 {
-	auto scriptFunctionIter = _cachedScripts.find(code);
+	auto scriptFunctionIter = findCachedScript(code);
 	if (scriptFunctionIter == _cachedScripts.end())
 		return false;
 
-	IScriptFunction *scriptFunction = scriptFunctionIter->second;
+	IScriptFunction *scriptFunction = scriptFunctionIter->second.function;
 	scriptFunction->decreaseReference();
 	if (!scriptFunction->isReferenced())
 	{
+		_cacheStats.sourceBytes -= scriptFunctionIter->second.source.length();
 		_cachedScripts.erase(scriptFunctionIter);
+		_cacheStats.entries = _cachedScripts.size();
 		delete scriptFunction;
 	}
 
@@ -314,31 +447,122 @@ bool CScriptEngine::ExecuteWeapon(TWeapon *weapon)
 	return true;
 }
 
+// Run scripts every 0.05 seconds
+constexpr std::chrono::nanoseconds timestep(std::chrono::milliseconds(50));
+
 void CScriptEngine::runTimers(const std::chrono::high_resolution_clock::time_point& time)
 {
 	auto delta_time = time - lastScriptTimer;
 	lastScriptTimer = time;
 
-	// Run scripts every 0.05 seconds
-	constexpr std::chrono::nanoseconds timestep(std::chrono::milliseconds(50));
 	accumulator += std::chrono::duration_cast<std::chrono::nanoseconds>(delta_time);
 	while (accumulator >= timestep)
 	{
 		accumulator -= timestep;
 
-		for (auto it = _updateNpcsTimer.begin(); it != _updateNpcsTimer.end(); )
-		{
-			TNPC *npc = *it;
-			bool hasUpdates = npc->runScriptTimer();
-
-			if (!hasUpdates)
-				it = _updateNpcsTimer.erase(it);
+		_timers.advance([](uint64_t id, NpcTimer&& timer) {
+			if (timer.action.getFunction())
+				timer.npc->runScheduledEvent(id, timer.action);
 			else
-				it++;
-		}
+				timer.npc->runTimeout();
+		});
 	}
 }
 
+bool CScriptEngine::runNextUpdate(std::map<int, TNPC *>& deleteNpcs)
+{
+	// Weapon events are triggered by players, they go first.
+	if (!_weaponQueue.empty())
+	{
+		TWeapon *weapon = _weaponQueue.front();
+		_weaponQueue.pop_front();
+
+		if (_updateWeapons.erase(weapon))
+			weapon->runScriptEvents();
+		return true;
+	}
+
+	for (size_t priority = 0; priority < (size_t)ScriptPriority::Count; priority++)
+	{
+		auto& queue = _npcQueues[priority];
+		if (queue.empty())
+			continue;
+
+		TNPC *npc = queue.front();
+		queue.pop_front();
+
+		// Skip entries of npcs that were unregistered or promoted since
+		auto it = _updateNpcs.find(npc);
+		if (it == _updateNpcs.end() || (size_t)it->second != priority)
+			return true;
+
+		auto response = npc->runScriptEvents();
+		if (response == NPCEventResponse::Delete)
+			deleteNpcs.emplace(npc->getId(), npc);
+
+		// Scripts can register or unregister npcs while running, so look it up again.
+		it = _updateNpcs.find(npc);
+		if (it == _updateNpcs.end())
+			return true;
+
+		if (response != NPCEventResponse::PendingEvents)
+			_updateNpcs.erase(it);
+		else if ((size_t)it->second == priority)
+			queue.push_back(npc);
+
+		return true;
+	}
+
+	return false;
+}
+
+std::chrono::high_resolution_clock::time_point CScriptEngine::getNextRunTime() const
+{
+	// Queued events still need to run, so don't wait.
+	if (!_updateNpcs.empty() || !_updateWeapons.empty())
+		return lastScriptTimer;
+
+	auto nextRunTime = std::chrono::high_resolution_clock::time_point::max();
+	if (!_timers.empty())
+		nextRunTime = lastScriptTimer + (timestep * _timers.nextExpiry() - accumulator);
+
+	// Without an eventfd finished requests can't wake up the main loop, so check for them regularly.
+	if (_httpRequests && !_httpRequests->getWakeupSocket() && _httpRequests->getInFlight() > 0)
+		nextRunTime = std::min(nextRunTime, std::chrono::high_resolution_clock::now() + std::chrono::milliseconds(10));
+
+	return nextRunTime;
+}
+
+void CScriptEngine::RunHttpRequests()
+{
+	if (!_httpRequests || _httpRequests->getInFlight() == 0)
+		return;
+
+	// Settling the promises runs their handlers, which are script code like any event,
+	// so they run under the script watcher and count towards the profile.
+	auto startTime = std::chrono::high_resolution_clock::now();
+	size_t finished = 0;
+	bool inTime = true;
+	_env->CallFunctionInScope([&]() -> void {
+		StartScriptExecution(startTime);
+		finished = _httpRequests->update();
+		if (finished > 0)
+			_env->RunMicrotasks();
+		inTime = StopScriptExecution();
+	});
+
+	if (finished == 0)
+		return;
+
+	if (!inTime)
+		reportScriptException("Promise handlers of http requests were stopped for running too long");
+
+#ifndef NOSCRIPTPROFILING
+	auto endTime = std::chrono::high_resolution_clock::now();
+	_httpProfile.addSample(endTime, endTime - startTime);
+#endif
+}
+
 void CScriptEngine::RunScripts(const std::chrono::high_resolution_clock::time_point& time)
 {
     runTimers(time);
@@ -348,36 +572,27 @@ void CScriptEngine::RunScripts(const std::chrono::high_resolution_clock::time_po
 		_env->CallFunctionInScope([&]() -> void {
 			std::map<int,TNPC*> deleteNpcs;
 
-			// Iterate over npcs
-			for (auto it = _updateNpcs.begin(); it != _updateNpcs.end(); )
-			{
-				TNPC *npc = *it;
-				auto response = npc->runScriptEvents();
-
-				if (response == NPCEventResponse::PendingEvents)
-				{
-					it++;
-					continue;
-				}
+			// Run the queued scripts round-robin until the budget is used up, the rest carry over
+			// to the next pass so packets keep being handled in between. Scripts that queue more
+			// events while running wait for their next turn.
+			auto deadline = std::chrono::high_resolution_clock::now() + _tickBudget;
+			size_t queued = _weaponQueue.size();
+			for (const auto& queue : _npcQueues)
+				queued += queue.size();
 
-				if (response == NPCEventResponse::Delete)
-					deleteNpcs.emplace(npc->getId(), npc);
-
-				it = _updateNpcs.erase(it);
+			for (size_t i = 0; i < queued && runNextUpdate(deleteNpcs); i++)
+			{
+				if (_tickBudget.count() > 0 && std::chrono::high_resolution_clock::now() >= deadline)
+					break;
 			}
 
-			// Iterate over weapons
-			for (auto weapon : _updateWeapons)
-				weapon->runScriptEvents();
-			_updateWeapons.clear();
-
 			// Delete any npcs
 			for (auto n : deleteNpcs)
 				_server->deleteNPC(n.first);
 		});
 	}
 
-	// No actions are queued, so we can assume no functions are cached here.
+	// Callbacks still used by queued actions are referenced, so they stay.
 	if (!_deletedCallbacks.empty())
 	{
 		for (auto it = _deletedCallbacks.begin(); it != _deletedCallbacks.end();)
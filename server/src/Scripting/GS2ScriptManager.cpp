@@ -11,13 +11,18 @@ GS2ScriptManager::GS2ScriptManager()
 void GS2ScriptManager::compileScript(const std::string& script, user_callback_type finishedCb)
 {
 	// Check to see if we already compiled this code before
-	auto cacheSearch = _bytecodeCache.find(script);
+	auto hash = utilities::contentHash(script);
+	auto cacheSearch = findBytecode(hash, script);
 	if (cacheSearch != _bytecodeCache.end())
 	{
-		finishedCb(cacheSearch->second);
+		_cacheStats.hits++;
+		_cacheStats.reusedBytes += script.length();
+		finishedCb(cacheSearch->second.response);
 		return;
 	}
 
+	_cacheStats.misses++;
+
 	// Disabling any async functionality for now, npcs should be compiled during level-loading
 	// and level should not be sent until all the npcs are finished compiling. Can't really
 	// enforce this since TLevel is loaded synchronously, but if it does turn into a problem
@@ -26,43 +31,68 @@ void GS2ScriptManager::compileScript(const std::string& script, user_callback_ty
 	// preloading any levels that are links from other levels or listed in a loaded map etc..
 
 	// Queue a job to compile this script
-	// queueCompileJob(script, finishedCb);
+	// queueCompileJob(script, hash, finishedCb);
 
 	// Synchronously compile script
-	syncCompileJob(script, finishedCb);
+	syncCompileJob(script, hash, finishedCb);
+}
+
+GS2ScriptManager::BytecodeCache::iterator GS2ScriptManager::findBytecode(const utilities::ContentHash& hash, const std::string& script)
+{
+	auto [it, end] = _bytecodeCache.equal_range(hash);
+	for (; it != end; ++it)
+	{
+		if (*it->second.source == script)
+			return it;
+	}
+
+	return _bytecodeCache.end();
+}
+
+const CompilerResponse& GS2ScriptManager::cacheBytecode(const utilities::ContentHash& hash, std::shared_ptr<const std::string> source, CompilerResponse&& response)
+{
+	// The same script may have been queued more than once, the first result is kept.
+	auto it = findBytecode(hash, *source);
+	if (it != _bytecodeCache.end())
+		return it->second.response;
+
+	size_t sourceLength = source->length();
+	it = _bytecodeCache.emplace(hash, CachedBytecode{ std::move(response), std::move(source) });
+	_cacheStats.entries = _bytecodeCache.size();
+	_cacheStats.sourceBytes += sourceLength;
+	return it->second.response;
 }
 
-void GS2ScriptManager::syncCompileJob(const std::string& script, user_callback_type& finishedCb)
+void GS2ScriptManager::syncCompileJob(const std::string& script, const utilities::ContentHash& hash, user_callback_type& finishedCb)
 {
 	// Compile code
 	auto result = _context.compile(script); // , "weapon", "TestCode", true);
 
-	// Insert into bytecode cache
-	auto ret = _bytecodeCache.insert({ script, std::move(result) });
-
-	// Call the user-defined callback after we insert the bytecode into the cache
-	finishedCb(ret.first->second);
+	// Insert into bytecode cache, and call the user-defined callback after
+	finishedCb(cacheBytecode(hash, std::make_shared<const std::string>(script), std::move(result)));
 }
 
-void GS2ScriptManager::queueCompileJob(const std::string& script, user_callback_type& finishedCb)
+void GS2ScriptManager::queueCompileJob(const std::string& script, const utilities::ContentHash& hash, user_callback_type& finishedCb)
 {
 	if constexpr (THREADPOOL_WORKERS == 0)
 	{
-		syncCompileJob(script, finishedCb);
+		syncCompileJob(script, hash, finishedCb);
 		return;
 	}
 
+	// One shared copy of the source is compiled by the worker and then kept by the cache
+	auto source = std::make_shared<const std::string>(script);
+
 	// Worker job
-	auto threadFunction = [script, finishedCb, this](CallbackThreadJob::thread_context &context, auto &promise)
+	auto threadFunction = [source, hash, finishedCb, this](CallbackThreadJob::thread_context &context, auto &promise)
 	{
 		// Compile code
-		auto result = context.gs2context.compile(script); // , "weapon", "TestCode", true);
+		auto result = context.gs2context.compile(*source); // , "weapon", "TestCode", true);
 
 		// Call the user-defined callback after we insert the bytecode into the cache
-		auto completedFunc = [this, script, finishedCb](CompilerResponse &response)
+		auto completedFunc = [this, hash, source, finishedCb](CompilerResponse &response)
 		{
-			auto ret = _bytecodeCache.insert({ script, std::move(response) });
-			finishedCb(ret.first->second);
+			finishedCb(cacheBytecode(hash, source, std::move(response)));
 		};
 
 		// Create a tuple with the callback, and arguments
@@ -0,0 +1,153 @@
+#ifdef V8NPCSERVER
+
+#include <algorithm>
+#include <thread>
+#include <httplib.h>
+#include "HttpRequestPool.h"
+
+HttpRequestPool::SharedState::SharedState(size_t pThreads, std::chrono::seconds pTimeout)
+	: threadCount(pThreads), timeout(pTimeout), running(true)
+{
+}
+
+HttpRequestPool::HttpRequestPool(size_t pThreads, size_t pMaxInFlight, std::chrono::seconds pTimeout)
+	: maxInFlight(pMaxInFlight), nextId(1)
+{
+	state = std::make_shared<SharedState>(std::max<size_t>(pThreads, 1), pTimeout);
+
+	for (size_t i = 0; i < state->threadCount; ++i)
+		std::thread(&HttpRequestPool::worker, state).detach();
+}
+
+HttpRequestPool::~HttpRequestPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(state->lock);
+		state->running = false;
+		state->queue.clear();
+	}
+	state->queueCondition.notify_all();
+
+	// Requests that are already running are left to hit their timeout, their results are dropped.
+}
+
+bool HttpRequestPool::request(HttpRequest pRequest, Callback pCallback)
+{
+	if (callbacks.size() >= maxInFlight)
+		return false;
+
+	uint64_t id = nextId++;
+	callbacks[id] = std::move(pCallback);
+
+	{
+		std::lock_guard<std::mutex> guard(state->lock);
+		state->queue.push_back(QueuedRequest{ id, std::move(pRequest) });
+	}
+	state->queueCondition.notify_one();
+	return true;
+}
+
+size_t HttpRequestPool::update()
+{
+	std::vector<FinishedRequest> results;
+	{
+		std::lock_guard<std::mutex> guard(state->lock);
+		if (state->finished.empty())
+			return 0;
+		results.swap(state->finished);
+	}
+
+	size_t called = 0;
+	for (auto& result : results)
+	{
+		auto it = callbacks.find(result.id);
+		if (it == callbacks.end())
+			continue;
+
+		// Callbacks can queue more requests, so take it out first.
+		auto callback = std::move(it->second);
+		callbacks.erase(it);
+		callback(result.response);
+		called++;
+	}
+
+	return called;
+}
+
+void HttpRequestPool::worker(std::shared_ptr<SharedState> pState)
+{
+	std::unique_lock<std::mutex> guard(pState->lock);
+	while (true)
+	{
+		pState->queueCondition.wait(guard, [&pState]() { return !pState->running || !pState->queue.empty(); });
+		if (!pState->running)
+			return;
+
+		auto request = std::move(pState->queue.front());
+		pState->queue.pop_front();
+
+		guard.unlock();
+		auto response = send(*pState, request.request);
+		guard.lock();
+
+		if (!pState->running)
+			return;
+
+		pState->finished.push_back(FinishedRequest{ request.id, std::move(response) });
+		pState->wakeup.signal();
+	}
+}
+
+HttpResponse HttpRequestPool::send(SharedState& pState, const HttpRequest& pRequest)
+{
+	auto client = acquireClient(pState, pRequest.host);
+
+	auto result = (pRequest.post ? client->Post(pRequest.path, pRequest.body, pRequest.contentType) : client->Get(pRequest.path));
+
+	HttpResponse response{};
+	if (result)
+	{
+		response.status = result->status;
+		response.body = std::move(result->body);
+		if (response.status < 200 || response.status >= 300)
+			response.error = "HTTP status " + std::to_string(response.status);
+	}
+	else response.error = httplib::to_string(result.error());
+
+	releaseClient(pState, pRequest.host, std::move(client));
+	return response;
+}
+
+std::unique_ptr<httplib::Client> HttpRequestPool::acquireClient(SharedState& pState, const std::string& pHost)
+{
+	{
+		std::lock_guard<std::mutex> guard(pState.lock);
+		auto it = pState.idleClients.find(pHost);
+		if (it != pState.idleClients.end() && !it->second.empty())
+		{
+			auto client = std::move(it->second.back());
+			it->second.pop_back();
+			return client;
+		}
+	}
+
+	auto client = std::make_unique<httplib::Client>(pHost);
+	client->enable_server_certificate_verification(false);
+	client->set_keep_alive(true);
+	client->set_connection_timeout(pState.timeout);
+	client->set_read_timeout(pState.timeout);
+	client->set_write_timeout(pState.timeout);
+	return client;
+}
+
+void HttpRequestPool::releaseClient(SharedState& pState, const std::string& pHost, std::unique_ptr<httplib::Client> pClient)
+{
+	std::lock_guard<std::mutex> guard(pState.lock);
+
+	// There are never more connections in use than there are threads.
+	auto& clients = pState.idleClients[pHost];
+	if (clients.size() < pState.threadCount)
+		clients.push_back(std::move(pClient));
+}
+
+#endif
@@ -0,0 +1,256 @@
+#include "ScriptPreprocessor.h"
+
+namespace
+{
+	inline bool isIdentifierChar(char c)
+	{
+		// Bytes of multi-byte characters are taken as identifier characters.
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+			|| c == '_' || c == '$' || (unsigned char)c >= 0x80;
+	}
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	inline size_t skipSpaces(std::string_view code, size_t pos)
+	{
+		while (pos < code.length() && isSpace(code[pos]))
+			pos++;
+		return pos;
+	}
+
+	inline size_t skipIdentifier(std::string_view code, size_t pos)
+	{
+		while (pos < code.length() && isIdentifierChar(code[pos]))
+			pos++;
+		return pos;
+	}
+
+	// Keywords after which a slash starts a regular expression instead of a division.
+	bool isRegexKeyword(std::string_view word)
+	{
+		static const std::string_view keywords[] = {
+			"return", "typeof", "instanceof", "in", "of", "new", "delete", "void",
+			"throw", "case", "do", "else", "yield", "await"
+		};
+
+		for (auto keyword : keywords)
+		{
+			if (word == keyword)
+				return true;
+		}
+		return false;
+	}
+
+	// Match `function name (` after a `public` ending at pos.
+	// Returns the position of the name, or 0 if it isn't a declaration.
+	size_t matchFunctionDeclaration(std::string_view code, size_t pos, size_t& nameEnd)
+	{
+		constexpr std::string_view function = "function";
+
+		size_t start = skipSpaces(code, pos);
+		if (start == pos || code.compare(start, function.length(), function) != 0)
+			return 0;
+
+		pos = start + function.length();
+		size_t nameStart = skipSpaces(code, pos);
+		if (nameStart == pos)
+			return 0;
+
+		nameEnd = skipIdentifier(code, nameStart);
+		if (nameEnd == nameStart)
+			return 0;
+
+		pos = skipSpaces(code, nameEnd);
+		if (pos == code.length() || code[pos] != '(')
+			return 0;
+
+		return nameStart;
+	}
+}
+
+std::vector<std::string> stripPublicFunctions(std::string_view code, std::string& out)
+{
+	std::vector<std::string> names;
+	out.reserve(out.length() + code.length());
+
+	size_t copied = 0;
+	size_t pos = 0;
+	bool regexAllowed = true;
+	char previous = 0;
+
+	// Open template literal substitutions, by the brace depth their closing brace returns to.
+	size_t braces = 0;
+	std::vector<size_t> substitutions;
+
+	while (pos < code.length())
+	{
+		char c = code[pos];
+
+		if (isSpace(c))
+		{
+			pos++;
+			continue;
+		}
+
+		if (c == '/' && pos + 1 < code.length() && code[pos + 1] == '/')
+		{
+			// Line comment, the newline is left for the next round.
+			auto end = code.find('\n', pos + 2);
+			pos = (end == std::string_view::npos ? code.length() : end);
+			continue;
+		}
+
+		if (c == '/' && pos + 1 < code.length() && code[pos + 1] == '*')
+		{
+			auto end = code.find("*/", pos + 2);
+			pos = (end == std::string_view::npos ? code.length() : end + 2);
+			continue;
+		}
+
+		if (c == '"' || c == '\'')
+		{
+			for (pos++; pos < code.length() && code[pos] != c; pos++)
+			{
+				if (code[pos] == '\\')
+					pos++;
+				else if (code[pos] == '\n')
+					break;
+			}
+
+			pos++;
+			regexAllowed = false;
+			previous = c;
+			continue;
+		}
+
+		if (c == '`' || (c == '}' && !substitutions.empty() && substitutions.back() == braces))
+		{
+			// A template literal, or the rest of one after a substitution. Substitutions are
+			// code, which can hold strings and braces of its own, so they are scanned as such.
+			if (c == '}')
+				substitutions.pop_back();
+
+			for (pos++; pos < code.length() && code[pos] != '`'; pos++)
+			{
+				if (code[pos] == '\\')
+					pos++;
+				else if (code[pos] == '$' && pos + 1 < code.length() && code[pos + 1] == '{')
+					break;
+			}
+
+			if (pos < code.length() && code[pos] == '$')
+			{
+				substitutions.push_back(braces);
+				pos += 2;
+				regexAllowed = true;
+				previous = '{';
+				continue;
+			}
+
+			pos++;
+			regexAllowed = false;
+			previous = '`';
+			continue;
+		}
+
+		if (c == '/' && regexAllowed)
+		{
+			bool inClass = false;
+			for (pos++; pos < code.length() && code[pos] != '\n'; pos++)
+			{
+				char r = code[pos];
+				if (r == '\\')
+					pos++;
+				else if (r == '[')
+					inClass = true;
+				else if (r == ']')
+					inClass = false;
+				else if (r == '/' && !inClass)
+					break;
+			}
+
+			// The flags are read as an identifier next round.
+			pos++;
+			regexAllowed = false;
+			previous = '/';
+			continue;
+		}
+
+		if (isIdentifierChar(c))
+		{
+			size_t end = skipIdentifier(code, pos);
+			std::string_view word = code.substr(pos, end - pos);
+
+			size_t nameEnd = 0;
+			size_t nameStart = (word == "public" && previous != '.') ? matchFunctionDeclaration(code, end, nameEnd) : 0;
+			if (nameStart != 0)
+			{
+				out.append(code.data() + copied, pos - copied);
+				copied = end;
+				names.emplace_back(code.substr(nameStart, nameEnd - nameStart));
+			}
+
+			regexAllowed = isRegexKeyword(word);
+			previous = c;
+			pos = end;
+			continue;
+		}
+
+		if ((c == '+' || c == '-') && pos + 1 < code.length() && code[pos + 1] == c)
+		{
+			// A slash after a postfix increment or decrement is a division, after a prefix
+			// one it starts a regular expression.
+			previous = c;
+			pos += 2;
+			continue;
+		}
+
+		if (c == '{')
+			braces++;
+		else if (c == '}' && braces > 0)
+			braces--;
+
+		// Punctuation, a slash after a closing bracket is a division.
+		regexAllowed = (c != ')' && c != ']');
+		previous = c;
+		pos++;
+	}
+
+	out.append(code.data() + copied, code.length() - copied);
+	return names;
+}
+
+std::string getPublicFunctionExports(const std::vector<std::string>& names)
+{
+	if (names.empty())
+		return {};
+
+	std::string varNames;
+	std::string varNameQuotes;
+	for (const auto& name : names)
+	{
+		varNames += name + ",";
+		varNameQuotes += "\"" + name + "\"" + ",";
+	}
+	varNames.pop_back();
+	varNameQuotes.pop_back();
+
+	std::string out;
+	out += "const __publicNames = [" + varNameQuotes + "];\n";
+	out += "const __publicFuncs = [" + varNames + "];\n";
+	out += R"(
+			for (let i = 0; i < __publicNames.length; ++i) {
+				if (__publicFuncs[i]) {
+					//print("Found fn ", __publicNames[i]);
+					self[__publicNames[i]] = __publicFuncs[i];
+				} else {
+					//print("Not found fn ", __publicNames[i]);
+				}
+			}
+		)";
+
+	return out;
+}
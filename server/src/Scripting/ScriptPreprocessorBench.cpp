@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ScriptPreprocessor.h"
+
+// Compares the script preprocessor against the std::regex rewrite it replaced, see the
+// preprocessorbench target.
+
+namespace
+{
+	const std::regex word_regex(R"((public[\s]+function[\s]+){1}(\w+)[\s]*\()");
+
+	std::vector<std::string> regexPreprocess(const std::string& code, std::string& out)
+	{
+		std::vector<std::string> names;
+		for (auto it = std::sregex_iterator(code.begin(), code.end(), word_regex); it != std::sregex_iterator(); ++it)
+			names.push_back((*it)[2]);
+
+		out.append(std::regex_replace(code, word_regex, "function $2("));
+		out.append(getPublicFunctionExports(names));
+		return names;
+	}
+
+	std::vector<std::string> tokenizerPreprocess(const std::string& code, std::string& out)
+	{
+		auto names = stripPublicFunctions(code, out);
+		out.append(getPublicFunctionExports(names));
+		return names;
+	}
+
+	struct Script
+	{
+		std::string path;
+		std::string code;
+	};
+
+	void addScript(const std::filesystem::path& path, std::vector<Script>& scripts)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		if (file)
+			scripts.push_back(Script{ path.string(), buffer.str() });
+	}
+
+	template<typename Func>
+	double timeRuns(const std::string& code, int runs, Func preprocess)
+	{
+		std::string out;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < runs; i++)
+		{
+			out.clear();
+			preprocess(code, out);
+		}
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count() / runs;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("USAGE: %s [-n RUNS] SCRIPT_FILE_OR_DIRECTORY...\n", argv[0]);
+		return 1;
+	}
+
+	int runs = 20;
+	std::vector<Script> scripts;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg(argv[i]);
+		if (arg == "-n" && i + 1 < argc)
+		{
+			runs = std::max(1, atoi(argv[++i]));
+			continue;
+		}
+
+		std::error_code ec;
+		if (std::filesystem::is_directory(arg, ec))
+		{
+			for (auto& entry : std::filesystem::recursive_directory_iterator(arg, ec))
+			{
+				if (entry.is_regular_file() && (entry.path().extension() == ".txt" || entry.path().extension() == ".js"))
+					addScript(entry.path(), scripts);
+			}
+		}
+		else addScript(arg, scripts);
+	}
+
+	if (scripts.empty())
+	{
+		printf("** [Error] No scripts found\n");
+		return 1;
+	}
+
+	// Largest scripts first, they are the ones that hold up level loading.
+	std::sort(scripts.begin(), scripts.end(), [](const Script& a, const Script& b) { return a.code.length() > b.code.length(); });
+
+	printf("%10s %12s %12s %8s  %s\n", "bytes", "regex (us)", "tokens (us)", "speedup", "script");
+
+	double regexTotal = 0, tokenizerTotal = 0;
+	size_t mismatches = 0;
+	for (const auto& script : scripts)
+	{
+		double regexTime = timeRuns(script.code, runs, regexPreprocess);
+		double tokenizerTime = timeRuns(script.code, runs, tokenizerPreprocess);
+		regexTotal += regexTime;
+		tokenizerTotal += tokenizerTime;
+
+		// The regex also matched declarations inside strings and comments, so a difference
+		// here isn't necessarily a fault in the tokenizer.
+		std::string unused;
+		bool same = regexPreprocess(script.code, unused) == tokenizerPreprocess(script.code, unused);
+		if (!same)
+			mismatches++;
+
+		printf("%10zu %12.1f %12.1f %7.1fx  %s%s\n", script.code.length(), regexTime, tokenizerTime,
+			tokenizerTime > 0 ? regexTime / tokenizerTime : 0.0, script.path.c_str(), same ? "" : " (public functions differ)");
+	}
+
+	printf("\n%zu scripts, %d runs each: regex %.1f ms, tokenizer %.1f ms per pass, %.1fx faster, %zu with different public functions\n",
+		scripts.size(), runs, regexTotal / 1000.0, tokenizerTotal / 1000.0,
+		tokenizerTotal > 0 ? regexTotal / tokenizerTotal : 0.0, mismatches);
+	return 0;
+}
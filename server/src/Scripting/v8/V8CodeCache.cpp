@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "V8CodeCache.h"
+
+namespace
+{
+	// Files hold the header, the v8 cache and then the script source.
+	const char CACHE_MAGIC[4] = { 'G', 'S', 'C', '2' };
+
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t versionTag;
+		uint32_t dataLength;
+		uint64_t sourceLength;
+		utilities::ContentHash sourceHash;
+	};
+}
+
+V8CodeCache::V8CodeCache(std::string pDirectory, std::chrono::hours pMaxAge)
+	: directory(std::move(pDirectory)), maxAge(pMaxAge), versionTag(v8::ScriptCompiler::CachedDataVersionTag()), running(true)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+
+	writeThread = std::thread(&V8CodeCache::writer, this);
+}
+
+V8CodeCache::~V8CodeCache()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		running = false;
+	}
+	writeCondition.notify_all();
+
+	// Pending writes are finished first, they are what makes the next start fast.
+	if (writeThread.joinable())
+		writeThread.join();
+}
+
+std::unique_ptr<v8::ScriptCompiler::CachedData> V8CodeCache::load(const std::string& pSource)
+{
+	auto sourceHash = utilities::contentHash(pSource);
+	std::string path = getPath(sourceHash);
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		++stats.misses;
+		return nullptr;
+	}
+
+	CacheHeader header{};
+	file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+	// Caches from another v8 build, or a script that only shares the hash, can't be used.
+	if (!file || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.versionTag != versionTag
+		|| header.sourceLength != pSource.length() || header.sourceHash != sourceHash)
+	{
+		++stats.misses;
+		return nullptr;
+	}
+
+	auto data = new uint8_t[header.dataLength];
+	file.read(reinterpret_cast<char *>(data), header.dataLength);
+
+	// The hash can be made to collide, and v8 only checks the length, so the source has to match too.
+	std::string source(pSource.length(), '\0');
+	file.read(source.data(), (std::streamsize)source.length());
+	if (!file || source != pSource)
+	{
+		delete[] data;
+		++stats.misses;
+		return nullptr;
+	}
+
+	// The modification time marks when the cache was last used, for prune().
+	std::error_code ec;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+	++stats.hits;
+	return std::make_unique<v8::ScriptCompiler::CachedData>(data, (int)header.dataLength, v8::ScriptCompiler::CachedData::BufferOwned);
+}
+
+void V8CodeCache::store(const std::string& pSource, v8::Local<v8::UnboundScript> pScript)
+{
+	std::unique_ptr<v8::ScriptCompiler::CachedData> cache(v8::ScriptCompiler::CreateCodeCache(pScript));
+	if (!cache || cache->length <= 0)
+		return;
+
+	CacheHeader header{};
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.versionTag = versionTag;
+	header.dataLength = (uint32_t)cache->length;
+	header.sourceLength = pSource.length();
+	header.sourceHash = utilities::contentHash(pSource);
+
+	PendingWrite write{ getPath(header.sourceHash), std::vector<uint8_t>(sizeof(header) + cache->length + pSource.length()) };
+	memcpy(write.data.data(), &header, sizeof(header));
+	memcpy(write.data.data() + sizeof(header), cache->data, cache->length);
+	memcpy(write.data.data() + sizeof(header) + cache->length, pSource.data(), pSource.length());
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		writes.push_back(std::move(write));
+	}
+	writeCondition.notify_one();
+}
+
+std::string V8CodeCache::getPath(const utilities::ContentHash& pHash) const
+{
+	char name[40];
+	snprintf(name, sizeof(name), "%016llx%016llx.v8c", (unsigned long long)pHash.high, (unsigned long long)pHash.low);
+	return directory + name;
+}
+
+void V8CodeCache::prune()
+{
+	auto oldest = std::filesystem::file_time_type::clock::now() - maxAge;
+
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+	{
+		std::error_code fileEc;
+		if (!entry.is_regular_file(fileEc))
+			continue;
+
+		// Temporary files are left over from a crash, anything else is a cache.
+		auto extension = entry.path().extension();
+		if (extension == ".tmp" || (extension == ".v8c" && maxAge.count() > 0 && entry.last_write_time(fileEc) < oldest))
+			std::filesystem::remove(entry.path(), fileEc);
+	}
+}
+
+void V8CodeCache::writer()
+{
+	// Runs before any write, so it never sees a temporary file of this run.
+	prune();
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (true)
+	{
+		writeCondition.wait(guard, [this]() { return !running || !writes.empty(); });
+		if (writes.empty())
+			return;
+
+		auto write = std::move(writes.front());
+		writes.pop_front();
+		guard.unlock();
+
+		// Write to a temporary file first so a crash never leaves a partial cache behind.
+		std::string tempPath = write.path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char *>(write.data.data()), (std::streamsize)write.data.size());
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, write.path, ec);
+		if (ec)
+			std::filesystem::remove(tempPath, ec);
+
+		guard.lock();
+	}
+}
@@ -944,7 +944,6 @@ void NPC_Function_ScheduleEvent(const v8::FunctionCallbackInfo<v8::Value>& args)
 
 		ScriptAction action(cbFuncWrapper, v8args, "_scheduleevent");
 		npcObject->scheduleEvent(timer_frames, action);
-		scriptEngine->RegisterNpcTimer(npcObject);
 	}
 
 	SCRIPTENV_D("End NPC::registerAction()\n");
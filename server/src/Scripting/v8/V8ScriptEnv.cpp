@@ -10,7 +10,7 @@ int V8ScriptEnv::s_count = 0;
 std::unique_ptr<v8::Platform> V8ScriptEnv::s_platform;
 
 V8ScriptEnv::V8ScriptEnv()
-	: _initialized(false), _isolate(nullptr)
+	: _initialized(false), _isolate(nullptr), _startupData{ nullptr, 0 }, _createSnapshot(false)
 {
 }
 
@@ -51,12 +51,55 @@ void V8ScriptEnv::Initialize()
 
 	// Create v8 isolate
 	create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
-	_isolate = v8::Isolate::New(create_params);
+	if (!_externalReferences.empty())
+		create_params.external_references = _externalReferences.data();
 
-	// Create global object and persist it
+	// Snapshots built by another v8 version, with other flags or other bindings can't be used
+	if (_snapshot && (_snapshot->versionTag != v8::ScriptCompiler::CachedDataVersionTag() || _snapshot->referenceCount != _externalReferences.size()))
+		_snapshot.reset();
+
+	if (_createSnapshot)
+	{
+		_snapshot.reset();
+		_snapshotCreator = std::make_unique<v8::SnapshotCreator>(create_params.external_references);
+		_isolate = _snapshotCreator->GetIsolate();
+	}
+	else
+	{
+		if (_snapshot)
+		{
+			_startupData = { _snapshot->blob.data(), (int)_snapshot->blob.length() };
+			create_params.snapshot_blob = &_startupData;
+		}
+
+		_isolate = v8::Isolate::New(create_params);
+	}
+
+	v8::Isolate::Scope isolate_scope(_isolate);
 	v8::HandleScope handle_scope(_isolate);
-	v8::Local<v8::ObjectTemplate> global_tpl = v8::ObjectTemplate::New(_isolate);
-	_global_tpl.Reset(_isolate, global_tpl);
+
+	if (_snapshot)
+	{
+		// The classes are bound already, pick up their templates and the bootstrap context
+		v8::Local<v8::ObjectTemplate> global_tpl = _isolate->GetDataFromSnapshotOnce<v8::ObjectTemplate>(0).ToLocalChecked();
+		_global_tpl.Reset(_isolate, global_tpl);
+
+		for (size_t i = 0; i < _snapshot->constructors.size(); i++)
+		{
+			v8::Local<v8::FunctionTemplate> func_tpl = _isolate->GetDataFromSnapshotOnce<v8::FunctionTemplate>(i + 1).ToLocalChecked();
+			_constructorMap[_snapshot->constructors[i]] = v8::Global<v8::FunctionTemplate>(_isolate, func_tpl);
+		}
+
+		v8::Local<v8::Context> context = v8::Context::FromSnapshot(_isolate, 0).ToLocalChecked();
+		_context.Reset(_isolate, context);
+		_global.Reset(_isolate, context->Global());
+	}
+	else
+	{
+		// Create global object and persist it
+		v8::Local<v8::ObjectTemplate> global_tpl = v8::ObjectTemplate::New(_isolate);
+		_global_tpl.Reset(_isolate, global_tpl);
+	}
 
 	// Increment v8 environment counter
 	V8ScriptEnv::s_count++;
@@ -81,10 +124,15 @@ void V8ScriptEnv::Cleanup(bool shutDown)
 	_global_tpl.Reset();
 	_context.Reset();
 
-	// Dispose of v8 isolate
-	_isolate->Dispose();
+	// Dispose of v8 isolate, the snapshot creator owns its isolate
+	if (_snapshotCreator)
+		_snapshotCreator.reset();
+	else
+		_isolate->Dispose();
 	_isolate = nullptr;
 	delete create_params.array_buffer_allocator;
+	_snapshot.reset();
+	_createSnapshot = false;
 
 	// Decrease v8 environment counter
 	V8ScriptEnv::s_count--;
@@ -151,15 +199,32 @@ IScriptFunction * V8ScriptEnv::Compile(const std::string& name, const std::strin
 	// Create a string containing the JavaScript source code.
 	v8::Local<v8::String> sourceStr = v8::String::NewFromUtf8(isolate, source.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
 
+	// Use the code cache from an earlier run if there is one, v8 takes ownership of it.
+	std::unique_ptr<v8::ScriptCompiler::CachedData> cachedData;
+	if (_codeCache)
+		cachedData = _codeCache->load(source);
+
+	auto compileOptions = (cachedData ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions);
+
 	// Compile the source code.
 	v8::TryCatch try_catch(isolate);
 	v8::ScriptOrigin origin(v8::String::NewFromUtf8(isolate, name.c_str(), v8::NewStringType::kNormal).ToLocalChecked());
+	v8::ScriptCompiler::Source scriptSource(sourceStr, origin, cachedData.release());
 	v8::Local<v8::Script> script;
-	if (!v8::Script::Compile(context, sourceStr, &origin).ToLocal(&script)) {
+	if (!v8::ScriptCompiler::Compile(context, &scriptSource, compileOptions).ToLocal(&script)) {
 		ParseErrors(&try_catch);
 		return nullptr;
 	}
 
+	// A cache that doesn't match this v8 build is rejected, and the script is compiled from source instead.
+	bool storeCache = (_codeCache != nullptr);
+	if (compileOptions == v8::ScriptCompiler::kConsumeCodeCache)
+	{
+		storeCache = scriptSource.GetCachedData()->rejected;
+		if (storeCache)
+			_codeCache->reject();
+	}
+
 	// Run the script to get the result.
 	v8::Local<v8::Value> result;
 
@@ -169,9 +234,80 @@ IScriptFunction * V8ScriptEnv::Compile(const std::string& name, const std::strin
 	}
 
 	assert(!try_catch.HasCaught());
+
+	// Created after running, so it includes the functions compiled while running.
+	if (storeCache)
+		_codeCache->store(source, script->GetUnboundScript());
+
 	return new V8ScriptFunction(this, result.As<v8::Function>());
 }
 
+IScriptFunction * V8ScriptEnv::GetSnapshotBootstrap()
+{
+	if (!_snapshot)
+		return nullptr;
+
+	v8::Locker lock(Isolate());
+	v8::Isolate::Scope isolate_scope(Isolate());
+	v8::HandleScope handle_scope(Isolate());
+
+	v8::Local<v8::Context> context = Context();
+	v8::Context::Scope context_scope(context);
+
+	v8::Local<v8::Function> bootstrap;
+	if (!context->GetDataFromSnapshotOnce<v8::Function>(0).ToLocal(&bootstrap))
+		return nullptr;
+
+	return new V8ScriptFunction(this, bootstrap);
+}
+
+bool V8ScriptEnv::CreateSnapshot(V8Snapshot& snapshot, std::unique_ptr<IScriptFunction> bootstrap)
+{
+	if (!_snapshotCreator || _context.IsEmpty() || !bootstrap)
+		return false;
+
+	{
+		v8::Isolate::Scope isolate_scope(Isolate());
+		v8::HandleScope handle_scope(Isolate());
+		v8::Local<v8::Context> context = Context();
+
+		// Isolate data, in the order Initialize() picks it up again
+		snapshot.constructors.clear();
+		_snapshotCreator->AddData(GlobalTemplate());
+		for (auto& it : _constructorMap)
+		{
+			_snapshotCreator->AddData(GlobalPersistentToLocal(Isolate(), it.second));
+			snapshot.constructors.push_back(it.first);
+		}
+
+		// The bootstrap context is added as context 0, the default context is left empty
+		_snapshotCreator->AddData(context, static_cast<V8ScriptFunction *>(bootstrap.get())->Function());
+
+		_snapshotCreator->SetDefaultContext(v8::Context::New(Isolate()));
+		_snapshotCreator->AddContext(context);
+	}
+
+	// v8 refuses to create a snapshot while anything still holds a handle
+	bootstrap.reset();
+	for (auto& it : _constructorMap)
+		it.second.Reset();
+	_constructorMap.clear();
+	_global.Reset();
+	_global_tpl.Reset();
+	_context.Reset();
+
+	// Keep the compiled functions, so the bootstrap doesn't need compiling again either
+	v8::StartupData data = _snapshotCreator->CreateBlob(v8::SnapshotCreator::FunctionCodeHandling::kKeep);
+	if (data.data == nullptr || data.raw_size <= 0)
+		return false;
+
+	snapshot.versionTag = v8::ScriptCompiler::CachedDataVersionTag();
+	snapshot.referenceCount = (uint32_t)_externalReferences.size();
+	snapshot.blob.assign(data.data, data.raw_size);
+	delete[] data.data;
+	return true;
+}
+
 void V8ScriptEnv::CallFunctionInScope(std::function<void()> function)
 {
 	// Fetch the v8 isolate, and create a stack-allocated scope for v8 calls
@@ -195,6 +331,12 @@ void V8ScriptEnv::TerminateExecution()
 	_isolate->TerminateExecution();
 }
 
+void V8ScriptEnv::RunMicrotasks()
+{
+	assert(_isolate);
+	_isolate->PerformMicrotaskCheckpoint();
+}
+
 bool V8ScriptEnv::SetConstructor(const std::string& key, v8::Local<v8::FunctionTemplate> func_tpl)
 {
 	auto it = _constructorMap.find(key);
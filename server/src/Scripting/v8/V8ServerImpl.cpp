@@ -1,6 +1,7 @@
 #ifdef V8NPCSERVER
 
 #include <cassert>
+#include <regex>
 #include <v8.h>
 #include <httplib.h>
 #include "CScriptEngine.h"
@@ -11,104 +12,113 @@
 #include "TNPC.h"
 #include "TPlayer.h"
 
-void Server_Function_HttpGet(const v8::FunctionCallbackInfo<v8::Value>& args) {
+// Split a url into the scheme and host, and the path.
+static bool splitUrl(const std::string& urlAndQuery, std::string& onlyUrl, std::string& onlyPath)
+{
+	std::regex urlRegex("(https?://[^/]+)(/?.*)");
+	std::smatch match;
+
+	if (!std::regex_search(urlAndQuery, match, urlRegex) || match.size() != 3)
+		return false;
+
+	onlyUrl = match[1].str();
+	onlyPath = match[2].str();
+	return true;
+}
+
+// Read the arguments of httpget/httppost: url, [postData, [contentType]]
+static bool readHttpRequest(const v8::FunctionCallbackInfo<v8::Value>& args, bool post, HttpRequest& request)
+{
 	v8::Isolate* isolate = args.GetIsolate();
 
 	// Check the number of arguments passed.
-	if (args.Length() < 1) {
+	if (args.Length() < (post ? 2 : 1)) {
 		isolate->ThrowException(v8::Exception::TypeError(
 				v8::String::NewFromUtf8(isolate, "Wrong number of arguments").ToLocalChecked()));
-		return;
+		return false;
 	}
 
 	// Check the argument types.
-	if (!args[0]->IsString()) {
+	if (!args[0]->IsString() || (post && !args[1]->IsString())) {
 		isolate->ThrowException(v8::Exception::TypeError(
 				v8::String::NewFromUtf8(isolate, "Wrong arguments").ToLocalChecked()));
-		return;
+		return false;
 	}
 
 	v8::String::Utf8Value url(isolate, args[0]);
-
-	std::string urlAndQuery = *url;
-	std::regex urlRegex("(https?://[^/]+)(/?.*)");
-	std::smatch match;
-	std::string onlyPath;
-	std::string onlyUrl;
-
-	if (std::regex_search(urlAndQuery, match, urlRegex) && match.size() == 3) {
-		onlyUrl = match[1].str();
-		onlyPath = match[2].str();
-	} else {
+	if (!splitUrl(*url, request.host, request.path)) {
 		isolate->ThrowException(v8::Exception::Error(
 			v8::String::NewFromUtf8(isolate, "Invalid url").ToLocalChecked()));
-		return;
+		return false;
 	}
 
-	auto cli = httplib::Client(onlyUrl);
-	cli.enable_server_certificate_verification(false);
-
-	auto r = cli.Get(onlyPath);
+	request.post = post;
+	if (post) {
+		v8::String::Utf8Value postData(isolate, args[1]);
+		request.body = *postData;
 
-	if (r->status < 200 || r->status >= 300) {
-		isolate->ThrowException(v8::Exception::Error(
-				v8::String::NewFromUtf8(isolate, to_string(r.error()).c_str()).ToLocalChecked()));
-		return;
+		if (args.Length() >= 3) {
+			v8::String::Utf8Value contentType(isolate, args[2]);
+			request.contentType = *contentType;
+		} else {
+			request.contentType = "application/json";
+		}
 	}
 
-	args.GetReturnValue().Set(v8::String::NewFromUtf8(isolate, r->body.c_str()).ToLocalChecked());
+	return true;
 }
 
-void Server_Function_HttpPost(const v8::FunctionCallbackInfo<v8::Value>& args) {
+// Queue the request on the http pool, and return a promise for the response body.
+static void Server_HttpRequestAsync(const v8::FunctionCallbackInfo<v8::Value>& args, bool post)
+{
 	v8::Isolate* isolate = args.GetIsolate();
+	v8::Local<v8::Context> context = isolate->GetCurrentContext();
 
-	// Check the number of arguments passed.
-	if (args.Length() < 2) {
-		isolate->ThrowException(v8::Exception::TypeError(
-				v8::String::NewFromUtf8(isolate, "Wrong number of arguments").ToLocalChecked()));
+	HttpRequest request{};
+	if (!readHttpRequest(args, post, request))
 		return;
-	}
 
-	// Check the argument types.
-	if (!args[0]->IsString() || !args[1]->IsString()) {
-		isolate->ThrowException(v8::Exception::TypeError(
-				v8::String::NewFromUtf8(isolate, "Wrong arguments").ToLocalChecked()));
-		return;
-	}
+	v8::Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(context).ToLocalChecked();
+	args.GetReturnValue().Set(resolver->GetPromise());
 
-	v8::String::Utf8Value url(isolate, args[0]);
-	v8::String::Utf8Value postData(isolate, args[1]);
-	std::string urlAndQuery = *url;
-	std::regex urlRegex("(https?://[^/]+)(/?.*)");
-	std::smatch match;
-	std::string onlyPath;
-	std::string onlyUrl;
+	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(args.Data().As<v8::External>()->Value());
+	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
-	if (std::regex_search(urlAndQuery, match, urlRegex) && match.size() == 3) {
-		onlyUrl = match[1].str();
-		onlyPath = match[2].str();
-	} else {
-		isolate->ThrowException(v8::Exception::Error(
-			v8::String::NewFromUtf8(isolate, "Invalid url").ToLocalChecked()));
-		return;
-	}
+	// Global handles can't be copied, but the callback has to be.
+	auto persistentResolver = std::make_shared<v8::Global<v8::Promise::Resolver>>(isolate, resolver);
 
-	std::string contentTypeStr;
-	if (args.Length() >= 3) {
-		v8::String::Utf8Value contentType(isolate, args[2]);
-		contentTypeStr=*contentType;
-	} else {
-		contentTypeStr="application/json";
-	}
+	bool queued = scriptEngine->getHttpRequests()->request(std::move(request), [env, persistentResolver](const HttpResponse& response) {
+		env->CallFunctionInScope([&]() -> void {
+			v8::Isolate *isolate = env->Isolate();
+			v8::Local<v8::Context> context = env->Context();
+			v8::Local<v8::Promise::Resolver> resolver = persistentResolver->Get(isolate);
 
-	auto cli = httplib::Client(onlyUrl);
-	cli.enable_server_certificate_verification(false);
+			if (response.error.empty())
+				resolver->Resolve(context, v8::String::NewFromUtf8(isolate, response.body.c_str(), v8::NewStringType::kNormal, (int)response.body.length()).ToLocalChecked()).Check();
+			else
+				resolver->Reject(context, v8::Exception::Error(v8::String::NewFromUtf8(isolate, response.error.c_str()).ToLocalChecked())).Check();
+		});
+	});
 
-	std::string postDataStr = *postData;
+	if (!queued)
+		resolver->Reject(context, v8::Exception::Error(v8::String::NewFromUtf8Literal(isolate, "Too many http requests in progress"))).Check();
+}
 
-	auto r = cli.Post(onlyPath, postDataStr, contentTypeStr);
+// Blocking version, which holds up the server until the request finishes.
+static void Server_HttpRequestSync(const v8::FunctionCallbackInfo<v8::Value>& args, bool post)
+{
+	v8::Isolate* isolate = args.GetIsolate();
 
-	if (r->status < 200 || r->status >= 300) {
+	HttpRequest request{};
+	if (!readHttpRequest(args, post, request))
+		return;
+
+	auto cli = httplib::Client(request.host);
+	cli.enable_server_certificate_verification(false);
+
+	auto r = (post ? cli.Post(request.path, request.body, request.contentType) : cli.Get(request.path));
+
+	if (!r || r->status < 200 || r->status >= 300) {
 		isolate->ThrowException(v8::Exception::Error(
 				v8::String::NewFromUtf8(isolate, to_string(r.error()).c_str()).ToLocalChecked()));
 		return;
@@ -117,6 +127,22 @@ void Server_Function_HttpPost(const v8::FunctionCallbackInfo<v8::Value>& args) {
 	args.GetReturnValue().Set(v8::String::NewFromUtf8(isolate, r->body.c_str()).ToLocalChecked());
 }
 
+void Server_Function_HttpGet(const v8::FunctionCallbackInfo<v8::Value>& args) {
+	Server_HttpRequestAsync(args, false);
+}
+
+void Server_Function_HttpPost(const v8::FunctionCallbackInfo<v8::Value>& args) {
+	Server_HttpRequestAsync(args, true);
+}
+
+void Server_Function_HttpGetSync(const v8::FunctionCallbackInfo<v8::Value>& args) {
+	Server_HttpRequestSync(args, false);
+}
+
+void Server_Function_HttpPostSync(const v8::FunctionCallbackInfo<v8::Value>& args) {
+	Server_HttpRequestSync(args, true);
+}
+
 void Server_Function_FindLevel(const v8::FunctionCallbackInfo<v8::Value>& args)
 {
 	v8::Isolate* isolate = args.GetIsolate();
@@ -516,6 +542,8 @@ void bindClass_Server(CScriptEngine *scriptEngine)
 	// Method functions
 	server_proto->Set(v8::String::NewFromUtf8Literal(isolate, "httpget"), v8::FunctionTemplate::New(isolate, Server_Function_HttpGet, engine_ref));
 	server_proto->Set(v8::String::NewFromUtf8Literal(isolate, "httppost"), v8::FunctionTemplate::New(isolate, Server_Function_HttpPost, engine_ref));
+	server_proto->Set(v8::String::NewFromUtf8Literal(isolate, "httpgetsync"), v8::FunctionTemplate::New(isolate, Server_Function_HttpGetSync, engine_ref));
+	server_proto->Set(v8::String::NewFromUtf8Literal(isolate, "httppostsync"), v8::FunctionTemplate::New(isolate, Server_Function_HttpPostSync, engine_ref));
 	server_proto->Set(v8::String::NewFromUtf8Literal(isolate, "findlevel"), v8::FunctionTemplate::New(isolate, Server_Function_FindLevel, engine_ref));
 	server_proto->Set(v8::String::NewFromUtf8Literal(isolate, "createlevel"), v8::FunctionTemplate::New(isolate, Server_Function_CreateLevel, engine_ref));
 	server_proto->Set(v8::String::NewFromUtf8Literal(isolate, "findnpc"), v8::FunctionTemplate::New(isolate, Server_Function_FindNPC, engine_ref));
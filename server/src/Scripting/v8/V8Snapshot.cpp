@@ -0,0 +1,96 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "V8Snapshot.h"
+
+namespace
+{
+	// Bumped when the layout changes, so older files are treated as damaged.
+	const char SNAPSHOT_MAGIC[4] = { 'G', 'S', 'S', '2' };
+
+	class Reader
+	{
+	public:
+		Reader(const std::string& pData, size_t pOffset) : data(pData), offset(pOffset) { }
+
+		bool readInt(uint32_t& pValue)
+		{
+			if (data.length() - offset < sizeof(pValue))
+				return false;
+
+			memcpy(&pValue, data.data() + offset, sizeof(pValue));
+			offset += sizeof(pValue);
+			return true;
+		}
+
+		bool readString(std::string& pValue)
+		{
+			uint32_t length;
+			if (!readInt(length) || data.length() - offset < length)
+				return false;
+
+			pValue.assign(data, offset, length);
+			offset += length;
+			return true;
+		}
+
+	private:
+		const std::string& data;
+		size_t offset;
+	};
+
+	void writeInt(std::string& pData, uint32_t pValue)
+	{
+		pData.append(reinterpret_cast<const char *>(&pValue), sizeof(pValue));
+	}
+
+	void writeString(std::string& pData, const std::string& pValue)
+	{
+		writeInt(pData, (uint32_t)pValue.length());
+		pData.append(pValue);
+	}
+}
+
+bool V8Snapshot::load(const std::string& pPath)
+{
+	std::ifstream file(pPath, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (data.length() < sizeof(SNAPSHOT_MAGIC) || memcmp(data.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+		return false;
+
+	Reader reader(data, sizeof(SNAPSHOT_MAGIC));
+	uint32_t constructorCount;
+	if (!reader.readInt(versionTag) || !reader.readInt(bootstrapChecksum) || !reader.readInt(bindingsChecksum)
+		|| !reader.readInt(referenceCount) || !reader.readInt(constructorCount))
+		return false;
+
+	constructors.resize(constructorCount);
+	for (auto& constructor : constructors)
+	{
+		if (!reader.readString(constructor))
+			return false;
+	}
+
+	return reader.readString(blob) && !blob.empty();
+}
+
+bool V8Snapshot::save(const std::string& pPath) const
+{
+	std::string data;
+	data.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	writeInt(data, versionTag);
+	writeInt(data, bootstrapChecksum);
+	writeInt(data, bindingsChecksum);
+	writeInt(data, referenceCount);
+	writeInt(data, (uint32_t)constructors.size());
+	for (const auto& constructor : constructors)
+		writeString(data, constructor);
+	writeString(data, blob);
+
+	std::ofstream file(pPath, std::ios::binary | std::ios::trunc);
+	file.write(data.data(), (std::streamsize)data.length());
+	return (bool)file;
+}
@@ -0,0 +1,21 @@
+#include <cstdio>
+#include "CScriptEngine.h"
+
+// Builds the v8 startup snapshot the server starts its script engine from, see the v8snapshot target.
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("USAGE: %s OUTPUT_FILE\n", argv[0]);
+		return 1;
+	}
+
+	if (!CScriptEngine::BuildSnapshot(argv[1]))
+	{
+		printf("** [Error] Failed to build the v8 snapshot %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("Built the v8 snapshot %s\n", argv[1]);
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include "IDebug.h"
+#include <atomic>
+#include <cstring>
+
+#include "main.h"
+#include "CString.h"
+
+#if !(defined(_WIN32) || defined(_WIN64))
+	#include <unistd.h>
+#endif
+
+// Home path of the gserver.
+CString homePath;
+std::string getBaseHomePath()
+{
+	return homePath.text();
+}
+
+void getBasePath()
+{
+#if defined(_WIN32) || defined(_WIN64)
+	// Get the path.
+	char path[ MAX_PATH ];
+	GetCurrentDirectoryA(MAX_PATH,path);
+
+	// Find the program exe and remove it from the path.
+	// Assign the path to homepath.
+	homePath = path;
+	homePath += "\\";
+	int pos = homePath.findl('\\');
+	if (pos == -1) homePath.clear();
+	else if (pos != (homePath.length() - 1))
+		homePath.removeI(++pos, homePath.length());
+#elif __APPLE__
+	char path[255];
+	if (!getcwd(path, sizeof(path)))
+		printf("Error getting CWD\n");
+
+	homePath = path;
+	if (homePath[homePath.length() - 1] != '/')
+		homePath << '/';
+#else
+	// Get the path to the program.
+	char path[260];
+	memset((void*)path, 0, 260);
+	readlink("/proc/self/exe", path, sizeof(path));
+
+	// Assign the path to homepath.
+	char* end = strrchr(path, '/');
+	if (end != 0)
+	{
+		end++;
+		if (end != 0) *end = '\0';
+		homePath = path;
+	}
+#endif
+}
+
+// Set by the signal handlers to stop the server.
+std::atomic_bool shutdownProgram{ false };
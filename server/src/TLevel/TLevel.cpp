@@ -986,18 +986,9 @@ bool TLevel::loadNW(const CString& pLevelName)
 */
 std::shared_ptr<TLevel> TLevel::findLevel(const CString& pLevelName, TServer* server, bool loadAbsolute)
 {
-	auto& levelList = server->getLevelList();
-
-	// TODO(joey): Maybe its time for a hashmap, even if a duplicate level name occurs
-	// 	this is still going to break on the first occurrence.
-
 	// Find Appropriate Level by Name
-	CString levelName = pLevelName.toLower();
-	for (auto & it : levelList)
-	{
-		if (it->getLevelName().toLower() == levelName)
-			return it;
-	}
+	if (auto level = server->findLoadedLevel(pLevelName); level)
+		return level;
 
 	if (loadAbsolute) {
 		CFileSystem* fileSystem = server->getFileSystem();
@@ -1015,6 +1006,7 @@ std::shared_ptr<TLevel> TLevel::findLevel(const CString& pLevelName, TServer* se
 	if (!level->loadLevel(pLevelName))
 		return nullptr;
 
+	CString levelName = pLevelName.toLower();
 	auto& mapList = server->getMapList();
 	for (const auto& map : mapList)
 	{
@@ -1027,7 +1019,7 @@ std::shared_ptr<TLevel> TLevel::findLevel(const CString& pLevelName, TServer* se
 	}
 
 	// Return Level
-	levelList.push_back(level);
+	server->addLevel(level);
 	return level;
 }
 
@@ -1036,8 +1028,6 @@ std::shared_ptr<TLevel> TLevel::findLevel(const CString& pLevelName, TServer* se
 */
 std::shared_ptr<TLevel> TLevel::createLevel(TServer* server, short fillTile, const std::string& levelName)
 {
-	auto& levelList = server->getLevelList();
-
 	// Load New Level
 	auto level = std::shared_ptr<TLevel>(new TLevel(fillTile, server));
 	level->setLevelName(levelName);
@@ -1047,7 +1037,7 @@ std::shared_ptr<TLevel> TLevel::createLevel(TServer* server, short fillTile, con
 #endif
 
 	// Return Level
-	levelList.push_back(level);
+	server->addLevel(level);
 	return level;
 }
 
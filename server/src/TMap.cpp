@@ -39,6 +39,48 @@ bool TMap::isLevelOnMap(const std::string& level, int& mapx, int& mapy) const
 	return false;
 }
 
+const std::string& TMap::getGridKey(const std::string& group) const
+{
+	static const std::string emptyStr;
+
+	// Only group maps keep the groups apart.
+	return (groupMap ? group : emptyStr);
+}
+
+void TMap::addPlayer(uint16_t id, int mx, int my, const std::string& group)
+{
+	if (mx < 0 || my < 0 || mx >= width || my >= height)
+		return;
+
+	auto& grid = playerGrids[getGridKey(group)];
+	if (grid.cells.empty())
+		grid.cells.resize(width * height);
+
+	grid.cells[mx + my * width].push_back(id);
+	++grid.count;
+}
+
+void TMap::removePlayer(uint16_t id, int mx, int my, const std::string& group)
+{
+	if (mx < 0 || my < 0 || mx >= width || my >= height)
+		return;
+
+	auto it = playerGrids.find(getGridKey(group));
+	if (it == playerGrids.end())
+		return;
+
+	auto& cell = it->second.cells[mx + my * width];
+	if (auto pit = std::find(cell.begin(), cell.end(), id); pit != cell.end())
+	{
+		*pit = cell.back();
+		cell.pop_back();
+
+		// Group maps come and go with their players, so don't keep empty grids around.
+		if (--it->second.count == 0)
+			playerGrids.erase(it);
+	}
+}
+
 const std::string& TMap::getLevelAt(int mx, int my) const
 {
 	static const std::string emptyStr;
@@ -77,7 +77,7 @@ TNPC::TNPC(TServer *pServer, NPCType type)
 #ifdef V8NPCSERVER
 	, _scriptExecutionContext(pServer->getScriptEngine())
 	, origX(x), origY(y), npcDeleteRequested(false), canWarp(NPCWarpType::None), width(32), height(32)
-	, timeout(0), _scriptEventsMask(0xFF)
+	, timeout(0), _scriptEventsMask(0xFF), _timeoutTimer(0)
 #endif
 {
 	memset((void*)colors, 0, sizeof(colors));
@@ -221,6 +221,17 @@ std::shared_ptr<TLevel> TNPC::getLevel() const
 	return curlevel.lock();
 }
 
+int TNPC::getTimeout() const
+{
+#ifdef V8NPCSERVER
+	// The timeout counts down in the script engine.
+	if (_timeoutTimer != 0)
+		return (int)server->getScriptEngine()->getTimerRemaining(_timeoutTimer);
+#endif
+
+	return timeout;
+}
+
 CString TNPC::getProp(unsigned char pId, int clientVersion) const
 {
 	auto level = getLevel();
@@ -854,8 +865,11 @@ void TNPC::freeScriptResources()
 	scriptEngine->UnregisterNpcUpdate(this);
 
 	// Clear timeouts & scheduled events
-	scriptEngine->UnregisterNpcTimer(this);
+	for (auto timerId : _scriptTimers)
+		scriptEngine->CancelTimer(timerId);
 	_scriptTimers.clear();
+	scriptEngine->CancelTimer(_timeoutTimer);
+	_timeoutTimer = 0;
 	timeout = 0;
 
 	// Clear triggeraction functions
@@ -962,12 +976,11 @@ void TNPC::updateClientCode()
 
 void TNPC::setTimeout(int newTimeout)
 {
-	timeout = newTimeout;
+	CScriptEngine *scriptEngine = server->getScriptEngine();
 
-	if (hasTimerUpdates())
-		server->getScriptEngine()->RegisterNpcTimer(this);
-	else
-		server->getScriptEngine()->UnregisterNpcTimer(this);
+	timeout = newTimeout;
+	scriptEngine->CancelTimer(_timeoutTimer);
+	_timeoutTimer = (timeout > 0 ? scriptEngine->ScheduleNpcTimeout(this, timeout) : 0);
 }
 
 void TNPC::queueNpcAction(const std::string& action, TPlayer *player, bool registerAction)
@@ -993,40 +1006,19 @@ void TNPC::queueNpcAction(const std::string& action, TPlayer *player, bool regis
 		scriptEngine->RegisterNpcUpdate(this);
 }
 
-bool TNPC::runScriptTimer()
+void TNPC::runTimeout()
 {
-	// TODO(joey): Scheduled events, pass in delta, use milliseconds as an integer
-
-	if (timeout > 0)
-	{
-		timeout--;
-		if (timeout == 0)
-			queueNpcAction("npc.timeout", 0, true);
-	}
-
-	// scheduled events
-	bool queued = false;
-	for (auto it = _scriptTimers.begin(); it != _scriptTimers.end();)
-	{
-		ScriptEventTimer& timer = *it;
-		timer.timer--;
-		if (timer.timer == 0)
-		{
-			_scriptExecutionContext.addAction(timer.action);
-			it = _scriptTimers.erase(it);
-			queued = true;
-			continue;
-		}
-
-		++it;
-	}
-
-	// Register for npc updates
-	if (queued)
-		server->getScriptEngine()->RegisterNpcUpdate(this);
+	timeout = 0;
+	_timeoutTimer = 0;
+	queueNpcAction("npc.timeout", 0, false);
+	server->getScriptEngine()->RegisterNpcUpdate(this, ScriptPriority::Timer);
+}
 
-	// return value dictates if this gets unregistered from timer updates
-	return hasTimerUpdates();
+void TNPC::runScheduledEvent(uint64_t timerId, ScriptAction& action)
+{
+	_scriptTimers.erase(timerId);
+	_scriptExecutionContext.addAction(action);
+	server->getScriptEngine()->RegisterNpcUpdate(this, ScriptPriority::Timer);
 }
 
 NPCEventResponse TNPC::runScriptEvents()
@@ -1295,12 +1287,13 @@ CString TNPC::getVariableDump()
 		}
 	}
 
-	if (timeout > 0)
-		npcDump << npcNameStr << ".timeout: " << CString((float)(timeout * 0.05f)) << "\n";
+	if (int remaining = getTimeout(); remaining > 0)
+		npcDump << npcNameStr << ".timeout: " << CString((float)(remaining * 0.05f)) << "\n";
 
-	std::pair<unsigned int, double> executionData = _scriptExecutionContext.getExecutionData();
-	npcDump << npcNameStr << ".scripttime (in the last min): " << CString(executionData.second) << "\n";
-	npcDump << npcNameStr << ".scriptcalls: " << CString(executionData.first) << "\n";
+	auto profileStats = _scriptExecutionContext.getProfileStats();
+	npcDump << npcNameStr << ".scripttime (in the last min): " << CString(profileStats.total) << "\n";
+	npcDump << npcNameStr << ".scriptcalls: " << CString((unsigned int)profileStats.calls) << "\n";
+	npcDump << npcNameStr << ".scripttime p50/p99/max: " << CString(profileStats.p50) << " / " << CString(profileStats.p99) << " / " << CString(profileStats.max) << "\n";
 
 	if (!flagList.empty())
 	{
@@ -1425,9 +1418,6 @@ void TNPC::saveNPC()
 	// TODO(joey): check if properties have been modified before deciding to save
 	// enumerate scriptObject variables, to save into file and load later..?
 
-	// Clean up old samples
-	//_scriptExecutionContext.getExecutionData();
-
 	/*
 	CString saveDir;
 	CString saveName;
@@ -1490,7 +1480,7 @@ void TNPC::saveNPC()
 	fileData << "COLORS " << CString((int)colors[0]) << "," << CString((int)colors[1]) << "," << CString((int)colors[2]) << "," << CString((int)colors[3]) << "," << CString((int)colors[4]) << NL;
 	fileData << "SPRITE " << CString(sprite) << NL;
 	fileData << "AP " << CString(ap) << NL;
-	fileData << "TIMEOUT " << CString(timeout / 20) << NL;
+	fileData << "TIMEOUT " << CString(getTimeout() / 20) << NL;
 	fileData << "LAYER 0" << NL;
 	fileData << "SHAPETYPE 0" << NL;
 	fileData << "SHAPE " << CString(width) << " " << CString(height) << NL;
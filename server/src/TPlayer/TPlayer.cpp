@@ -325,10 +325,18 @@ packetCount(0), firstLevel(true), invalidPackets(0)
 {
 	lastData = lastMovement = lastSave = last1m = time(0);
 	lastChat = lastMessage = lastNick = 0;
+	mapX = mapY = 0;
 	isExternal = false;
 	serverName = server->getName();
 	nextExternalPlayerId = 16000;
 
+	// Share compressed broadcast frames with the other players.
+	fileQueue.setFrameCache(&server->getBroadcastFrameCache());
+
+	// The npc-server has no socket, so nothing to flush.
+	if (pSocket != nullptr)
+		fileQueue.setLimits(&server->getOutboundLimits());
+
 	srand((unsigned int)time(0));
 
 	// Create Functions
@@ -347,6 +355,7 @@ void TPlayer::cleanup()
 		return;
 
 	// Send all unsent data (for disconnect messages and whatnot).
+	fileQueue.release();
 	fileQueue.sendCompress();
 
 	if (id >= 0 && server != nullptr && loaded)
@@ -357,6 +366,7 @@ void TPlayer::cleanup()
 
 		// Remove from the level.
 		if (!curlevel.expired()) leaveLevel();
+		removeFromMapGrid();
 
 		// Announce our departure to other clients.
 		if (!isNC()) {
@@ -405,11 +415,18 @@ bool TPlayer::onRecv()
 	unsigned int size = 0;
 	char* data = playerSock->getData(&size);
 	if (size != 0) {
-		rBuffer.write(data, size);
 #if defined(WOLFSSL_ENABLED)
 		if (this->playerSock->webSocket)
-			if (webSocketFixIncomingPacket(rBuffer) < 0) return true;
+		{
+			// Frames are collected until they are complete, then only their payload is framed.
+			wsBuffer.write(data, size);
+			if (webSocketFixIncomingPacket(wsBuffer) < 0) return true;
+			rBuffer.write(wsBuffer.text(), wsBuffer.length());
+			wsBuffer.clear();
+		}
+		else
 #endif
+		rBuffer.write(data, size);
 	}
 	else if (playerSock->getState() == SOCKET_STATE_DISCONNECTED)
 		return false;
@@ -419,6 +436,16 @@ bool TPlayer::onRecv()
 
 }
 
+void TPlayer::flushPackets()
+{
+	if (playerSock == 0 || playerSock->getState() == SOCKET_STATE_DISCONNECTED)
+		return;
+
+	fileQueue.release();
+	fileQueue.sendCompress();
+	scheduleSend();
+}
+
 bool TPlayer::onSend()
 {
 	if (playerSock == 0 || playerSock->getState() == SOCKET_STATE_DISCONNECTED)
@@ -426,6 +453,7 @@ bool TPlayer::onSend()
 
 	// Send data.
 	fileQueue.sendCompress();
+	scheduleSend();
 
 	return true;
 }
@@ -455,61 +483,68 @@ bool TPlayer::doMain()
 	// definitions
 	CString unBuffer;
 
-	// parse data
-	rBuffer.setRead(0);
-	while (rBuffer.length() > 1)
-	{
 #if defined(WOLFSSL_ENABLED)
-		if (!this->playerSock->webSocket && rBuffer.findi("GET /") > -1 && rBuffer.findi("HTTP/1.1\r\n") > -1)
-		{
+	// Look for an http request once per recv, instead of copying the buffer again for every frame.
+	CString httpBuffer;
+	if (!this->playerSock->webSocket && rBuffer.length() > 1)
+		httpBuffer.write(rBuffer.data(), (int)rBuffer.length());
 
-			CString webSocketKeyHeader = "Sec-WebSocket-Key:";
-			if (rBuffer.findi(webSocketKeyHeader) < 0) {
-				CString simpleHtml = CString() << "<html><head><title>" APP_VENDOR " " APP_NAME " v" APP_VERSION "</title></head><body><h1>Welcome to " << server->getSettings().getStr("name") << "!</h1>" << server->getServerMessage().replaceAll("my server", server->getSettings().getStr("name")).text() << "<p style=\"font-style: italic;font-weight: bold;\">Powered by " APP_VENDOR " " APP_NAME "<br/>Programmed by " << CString(APP_CREDITS) << "</p></body></html>";
-				CString webResponse = CString() << "HTTP/1.1 200 OK\r\nServer: " APP_VENDOR " " APP_NAME " v" APP_VERSION "\r\nContent-Length: " << CString(simpleHtml.length()) << "\r\nContent-Type: text/html\r\n\r\n" << simpleHtml << "\r\n";
-				unsigned int dsize = webResponse.length();
-				this->playerSock->sendData(webResponse.text(), &dsize);
-				return false;
-			}
-			this->playerSock->webSocket = true;
-			// Get the WebSocket handshake key
-			rBuffer.setRead(rBuffer.findi(webSocketKeyHeader));
-			CString webSocketKey = rBuffer.readString("\r").subString(webSocketKeyHeader.length()+1).trimI();
+	if (!httpBuffer.isEmpty() && httpBuffer.findi("GET /") > -1 && httpBuffer.findi("HTTP/1.1\r\n") > -1)
+	{
 
-			// Append GUID
-			webSocketKey << "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+		CString webSocketKeyHeader = "Sec-WebSocket-Key:";
+		if (httpBuffer.findi(webSocketKeyHeader) < 0) {
+			CString simpleHtml = CString() << "<html><head><title>" APP_VENDOR " " APP_NAME " v" APP_VERSION "</title></head><body><h1>Welcome to " << server->getSettings().getStr("name") << "!</h1>" << server->getServerMessage().replaceAll("my server", server->getSettings().getStr("name")).text() << "<p style=\"font-style: italic;font-weight: bold;\">Powered by " APP_VENDOR " " APP_NAME "<br/>Programmed by " << CString(APP_CREDITS) << "</p></body></html>";
+			CString webResponse = CString() << "HTTP/1.1 200 OK\r\nServer: " APP_VENDOR " " APP_NAME " v" APP_VERSION "\r\nContent-Length: " << CString(simpleHtml.length()) << "\r\nContent-Type: text/html\r\n\r\n" << simpleHtml << "\r\n";
+			unsigned int dsize = webResponse.length();
+			this->playerSock->sendData(webResponse.text(), &dsize);
+			return false;
+		}
+		this->playerSock->webSocket = true;
+		// Get the WebSocket handshake key
+		httpBuffer.setRead(httpBuffer.findi(webSocketKeyHeader));
+		CString webSocketKey = httpBuffer.readString("\r").subString(webSocketKeyHeader.length()+1).trimI();
 
-			// Calculate sha1 has of key + GUID and base64 encode it for sending back
-			webSocketKey.sha1I().base64encodeI();
-			webSocketKeyHeader.clear();
+		// Append GUID
+		webSocketKey << "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
-			CString webSockHandshake = CString() <<"HTTP/1.1 101 Switching Protocols\r\n"
-											 << "Upgrade: websocket\r\n"
-											 << "Connection: Upgrade\r\n"
-											 << "Sec-WebSocket-Protocol: binary\r\n"
-											 << "Sec-WebSocket-Accept: "
-											 << webSocketKey
-											 << "\r\n\r\n";
+		// Calculate sha1 has of key + GUID and base64 encode it for sending back
+		webSocketKey.sha1I().base64encodeI();
+		webSocketKeyHeader.clear();
 
-			unsigned int dsize = webSockHandshake.length();
+		CString webSockHandshake = CString() <<"HTTP/1.1 101 Switching Protocols\r\n"
+										 << "Upgrade: websocket\r\n"
+										 << "Connection: Upgrade\r\n"
+										 << "Sec-WebSocket-Protocol: binary\r\n"
+										 << "Sec-WebSocket-Accept: "
+										 << webSocketKey
+										 << "\r\n\r\n";
 
-			this->playerSock->sendData(webSockHandshake.text(), &dsize);
+		unsigned int dsize = webSockHandshake.length();
 
-			rBuffer.removeI(0, rBuffer.length());
-			return true;
-		}
+		this->playerSock->sendData(webSockHandshake.text(), &dsize);
+
+		rBuffer.clear();
+		return true;
+	}
 #endif
+
+	// parse data
+	while (rBuffer.length() > 1)
+	{
 		// New data.
 		lastData = time(0);
 
 		// packet length
-		auto len = (unsigned short)rBuffer.readShort();
+		auto len = rBuffer.peekShort();
 		if ((unsigned int)len > (unsigned int)rBuffer.length()-2)
 			break;
 
 		// get packet
-		unBuffer = rBuffer.readChars(len);
-		rBuffer.removeI(0, len+2);
+		auto frame = rBuffer.view(2, len);
+		unBuffer.clear(len);
+		unBuffer.write(frame.data(), (int)frame.size());
+		rBuffer.consume(len+2);
 
 		// decrypt packet
 		switch (in_codec.getGen())
@@ -549,7 +584,7 @@ bool TPlayer::doMain()
 	}
 	grMovementUpdated = false;
 
-	server->getSocketManager().updateSingle(this, false, true);
+	// Replies are sent with everything else at the end of the main loop pass.
 	return true;
 }
 
@@ -765,6 +800,26 @@ void TPlayer::sendPacket(CString pPacket, bool appendNL)
 
 	// append buffer
 	fileQueue.addPacket(pPacket);
+	scheduleSend();
+}
+
+void TPlayer::sendPacket(const SharedPacket& pPacket)
+{
+	// Already newline terminated, so queue it as is.
+	fileQueue.addPacket(pPacket, true);
+	scheduleSend();
+}
+
+void TPlayer::scheduleSend()
+{
+	if (playerSock == nullptr)
+		return;
+
+	// Held gameplay packets go out on the next flush, throttled file data once the budget allows it.
+	if (fileQueue.canSend())
+		server->requestSend(this);
+	else if (auto next = fileQueue.nextSendTime(); next != OutboundLimits::clock::time_point::max())
+		server->requestSend(this, next - OutboundLimits::clock::now());
 }
 
 bool TPlayer::sendFile(const CString& pFile)
@@ -797,22 +852,20 @@ bool TPlayer::sendFile(const CString& pFile)
 bool TPlayer::sendFile(const CString& pPath, const CString& pFile)
 {
 	CString filepath = server->getServerPath() << pPath << pFile;
-	CString fileData;
-	fileData.load(filepath);
 
-	time_t modTime = 0;
-	struct stat fileStat;
-	if (stat(filepath.text(), &fileStat) != -1)
-		modTime = fileStat.st_mtime;
+	// The file contents are shared with everyone else downloading it.
+	auto file = server->getFileCache().get(filepath);
 
 	// See if the file exists.
-	if (fileData.length() == 0)
+	if (!file || file->data.length() == 0)
 	{
 		sendPacket(CString() >> (char)PLO_FILESENDFAILED << pFile);
 
 		return false;
 	}
 
+	const CString& fileData = file->data;
+
 	// Warn for very large files.  These are the cause of many bug reports.
 	if (fileData.length() > 3145728)	// 3MB
 		serverlog.out("[%s] [WARNING] Sending a large file (over 3MB): %s\n", server->getName().text(), pFile.text());
@@ -822,7 +875,7 @@ bool TPlayer::sendFile(const CString& pPath, const CString& pFile)
 	// 1 (PLO_FILE) + 5 (modTime) + 1 (file.length()) + file.length() + 1 (\n)
 	bool isBigFile = false;
 	int packetLength = 1 + 5 + 1 + pFile.length() + 1;
-	if (fileData.length() > 32000)
+	if (fileData.length() > FILE_CHUNK_SIZE)
 		isBigFile = true;
 
 	// Clients before 2.14 didn't support large files.
@@ -844,27 +897,28 @@ bool TPlayer::sendFile(const CString& pPath, const CString& pFile)
 		sendPacket(CString() >> (char)PLO_LARGEFILESIZE >> (long long)fileData.length());
 	}
 
-	// Send the file now.
-	while (fileData.length() != 0)
+	// Large files are compressed once for everyone that downloads them.
+	std::shared_ptr<const PrecompressedFile> precompressed;
+	if (!(isClient() && versionID < CLVER_2_14))
 	{
-		int sendSize = clip(32000, 0, fileData.length());
-		if (isClient() && versionID < CLVER_2_14) sendSize = fileData.length();
-
-		// Older client versions didn't send the modTime.
-		if (isClient() && versionID < CLVER_2_1)
-		{
-			// We don't add a \n to the end of the packet, so subtract 1 from the packet length.
-			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength - 1 + sendSize));
-			sendPacket(CString() >> (char)PLO_FILE >> (char)pFile.length() << pFile << fileData.subString(0, sendSize), false);
-		}
-		else
-		{
-			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength + sendSize));
-			sendPacket(CString() >> (char)PLO_FILE >> (long long)modTime >> (char)pFile.length() << pFile << fileData.subString(0, sendSize) << "\n", false);
-		}
+		if (auto checksum = server->getFileCache().getChecksum(filepath); checksum)
+			precompressed = server->getPrecompressedFiles().find(pFile, file, checksum->checksum);
+	}
 
-		fileData.removeI(0, sendSize);
+	// Send the file now.  The chunks are only built as the queue gets to them, so a
+	// download doesn't hold its own copy of the file.
+	if (precompressed)
+	{
+		for (const auto& frame : precompressed->frames)
+			fileQueue.addFrame(std::shared_ptr<const PrecompressedFrame>(precompressed, &frame));
+	}
+	else
+	{
+		bool sendModTime = !(isClient() && versionID < CLVER_2_1);
+		int chunkSize = (isClient() && versionID < CLVER_2_14 ? fileData.length() : FILE_CHUNK_SIZE);
+		fileQueue.addStream(std::make_unique<FileSendStream>(file, pFile, packetLength, chunkSize, sendModTime));
 	}
+	scheduleSend();
 
 	// If we had sent a large file, let the client know we finished sending it.
 	if (isBigFile) sendPacket(CString() >> (char)PLO_LARGEFILEEND << pFile);
@@ -1626,6 +1680,7 @@ bool TPlayer::setLevel(const CString& pLevelName, time_t modTime)
 	// Add myself to the level playerlist.
 	newLevel->addPlayer(id);
 	levelName = newLevel->getLevelName();
+	addToMapGrid();
 
 	// Tell the client their new level.
 	if (modTime == 0 || versionID < CLVER_2_1)
@@ -1663,12 +1718,14 @@ bool TPlayer::setLevel(const CString& pLevelName, time_t modTime)
 	}
 
 	// Inform everybody as to the client's new location.  This will update the minimap.
-	CString minimap = this->getProps(0, 0) >> (char)PLPROP_CURLEVEL << this->getProp(PLPROP_CURLEVEL) >> (char)PLPROP_X << this->getProp(PLPROP_X) >> (char)PLPROP_Y << this->getProp(PLPROP_Y);
+	auto minimap = makeSharedPacket(this->getProps(0, 0) >> (char)PLPROP_CURLEVEL << this->getProp(PLPROP_CURLEVEL) >> (char)PLPROP_X << this->getProp(PLPROP_X) >> (char)PLPROP_Y << this->getProp(PLPROP_Y));
+	auto map = pmap.lock();
+	bool isGroupMap = (map && map->isGroupMap());
 	for (auto& [pid, player] : server->getPlayerList())
 	{
 		if (pid == this->getId())
 			continue;
-		if (auto map = pmap.lock(); map && map->isGroupMap() && levelGroup != player->getGroup())
+		if (isGroupMap && mapGroup != player->getMapGroup())
 			continue;
 
 		player->sendPacket(minimap);
@@ -1771,23 +1828,15 @@ bool TPlayer::sendLevel(std::shared_ptr<TLevel> pLevel, time_t modTime, bool fro
 		// Get other player props.
 		if (auto map = pmap.lock(); map)
 		{
-			auto sgmap{this->getMapPosition()};
-			auto isGroupMap = map->isGroupMap();
-
-			for (const auto &[otherid, other]: server->getPlayerList())
-			{
-				if (id == otherid) continue;
-				if (!other->isClient()) continue;
+			// Only check the players in the surrounding levels.
+			map->forEachPlayerNear(mapX, mapY, &mapGroup, [&](uint16_t otherid) {
+				if (id == otherid) return;
 
-				auto othermap = other->getMap().lock();
-				if (!othermap || othermap != map) continue;
-				if (isGroupMap && this->getGroup() != other->getGroup()) continue;
+				auto other = server->getPlayer(otherid);
+				if (!other || !other->isClient()) return;
 
-				// Check if they are nearby before sending the packet.
-				auto ogmap{other->getMapPosition()};
-				if (abs(ogmap.first - sgmap.first) < 2 && abs(ogmap.second - sgmap.second) < 2)
-					this->sendPacket(other->getProps(__getLogin, sizeof(__getLogin) / sizeof(bool)));
-			}
+				this->sendPacket(other->getProps(__getLogin, sizeof(__getLogin) / sizeof(bool)));
+			});
 		}
 		else
 		{
@@ -1883,6 +1932,8 @@ bool TPlayer::sendLevel141(std::shared_ptr<TLevel> pLevel, time_t modTime, bool
 
 bool TPlayer::leaveLevel(bool resetCache)
 {
+	removeFromMapGrid();
+
 	// Make sure we are on a level first.
 	auto levelp = curlevel.lock();
 	if (!levelp) return true;
@@ -1955,25 +2006,49 @@ void TPlayer::resetLevelCache(const TLevel* level)
 	}
 }
 
-std::pair<int, int> TPlayer::getMapPosition() const
+void TPlayer::setGroup(CString group)
 {
-	if (curlevel.expired()) return { 0, 0 };
-	if (pmap.expired()) return { 0, 0 };
+	// Group maps keep each group in its own grid, so leave the old one while mapGroup still names it.
+	bool onGrid = !gridMap.expired();
+	if (onGrid)
+		removeFromMapGrid();
 
-	auto level = getLevel();
+	levelGroup = group;
+	mapGroup = levelGroup.text();
+
+	if (onGrid)
+		addToMapGrid();
+}
+
+void TPlayer::setMap(std::shared_ptr<TMap> map)
+{
+	pmap = map;
+	if (!map)
+		removeFromMapGrid();
+}
+
+void TPlayer::addToMapGrid()
+{
+	removeFromMapGrid();
+
+	auto level = curlevel.lock();
 	auto map = pmap.lock();
-	if (!level || !map) return { 0, 0 };
+	if (!level || !map)
+		return;
 
-	switch (map->getType())
-	{
-	case MapType::BIGMAP:
-		return { level->getMapX(), level->getMapY() };
-	default:
-	case MapType::GMAP:
-		return { getProp(PLPROP_GMAPLEVELX).readGUChar() , getProp(PLPROP_GMAPLEVELY).readGUChar() };
-	}
+	gridMap = map;
+	mapX = level->getMapX();
+	mapY = level->getMapY();
+	map->addPlayer(id, mapX, mapY, mapGroup);
+}
+
+void TPlayer::removeFromMapGrid()
+{
+	if (auto map = gridMap.lock(); map)
+		map->removePlayer(id, mapX, mapY, mapGroup);
 
-	return { 0, 0 };
+	gridMap.reset();
+	mapX = mapY = 0;
 }
 
 void TPlayer::setChat(const CString& pChat)
@@ -19,6 +19,10 @@
 #include "TLevel.h"
 #include "IConfig.h"
 
+#ifdef V8NPCSERVER
+#include "V8ScriptEnv.h"
+#endif
+
 #define serverlog	server->getServerLog()
 #define rclog		server->getRCLog()
 #define nclog		server->getNPCLog()
@@ -58,6 +62,23 @@ const int __importantFileRights[] = {
 
 static void updateFile(TPlayer* player, TServer* server, CString& dir, CString& file);
 
+static std::string formatScriptCacheStats(const char* name, const ScriptCacheStats& stats)
+{
+	size_t lookups = stats.hits + stats.misses;
+	return fmt::format("Script cache ({}): {} scripts, {:.1f} KB source, {} hits / {} misses ({:.1f}%), {:.1f} KB not recompiled",
+		name, stats.entries, stats.sourceBytes / 1024.0, stats.hits, stats.misses,
+		lookups ? 100.0 * stats.hits / lookups : 0.0, stats.reusedBytes / 1024.0);
+}
+
+#ifdef V8NPCSERVER
+static std::string formatCodeCacheStats(const CodeCacheStats& stats)
+{
+	size_t lookups = stats.hits + stats.misses;
+	return fmt::format("Code cache (scriptcache/): {} loaded / {} compiled ({:.1f}%), {} rejected by v8",
+		stats.hits, stats.misses, lookups ? 100.0 * stats.hits / lookups : 0.0, stats.rejected);
+}
+#endif
+
 void TPlayer::setPropsRC(CString& pPacket, TPlayer* rc)
 {
 	bool hadBomb = false, hadBow = false;
@@ -1109,9 +1130,9 @@ bool TPlayer::msgPLI_RC_CHAT(CString& pPacket)
 			nclog.out("%s saved the npcs to disk.\n", accountName.text());
 			server->saveNpcs();
 		}
-		else if (words[0] == "/stats" && words.size() == 1)
+		else if (words[0] == "/stats" && (words.size() == 1 || (words.size() == 2 && words[1] == "events")))
 		{
-			auto npcStats = server->calculateNpcStats();
+			auto npcStats = server->calculateNpcStats(words.size() == 2);
 
 			sendPacket(CString() >> (char)PLO_RC_CHAT << "Top scripts using the most execution time (in the last min)");
 
@@ -1119,11 +1140,22 @@ bool TPlayer::msgPLI_RC_CHAT(CString& pPacket)
 			for (auto it = npcStats.begin(); it != npcStats.end(); ++it)
 			{
 				idx++;
-				sendPacket(CString() >> (char)PLO_RC_CHAT << CString(idx) << ". 	" << CString((*it).first) << "	" << (*it).second);
+				const auto& stats = (*it).second;
+				sendPacket(CString() >> (char)PLO_RC_CHAT << fmt::format("{}. 	{:.3f}s	{:.1f} calls/s	p50 {:.2f}ms	p99 {:.2f}ms	max {:.2f}ms	{}",
+					idx, stats.total, stats.callsPerSecond, stats.p50 * 1000.0, stats.p99 * 1000.0, stats.max * 1000.0, (*it).first));
 				if (idx == 50)
 					break;
 			}
 		}
+		else if (words[0] == "/scriptcache" && words.size() == 1)
+		{
+			sendPacket(CString() >> (char)PLO_RC_CHAT << formatScriptCacheStats("v8", server->getScriptEngine()->getCacheStats()));
+			sendPacket(CString() >> (char)PLO_RC_CHAT << formatScriptCacheStats("gs2", server->getGS2ScriptManager().getCacheStats()));
+
+			auto env = static_cast<V8ScriptEnv *>(server->getScriptEngine()->getScriptEnv());
+			if (env != nullptr && env->GetCodeCache() != nullptr)
+				sendPacket(CString() >> (char)PLO_RC_CHAT << formatCodeCacheStats(env->GetCodeCache()->getStats()));
+		}
 #endif
 		else if(words[0] == "/find" && words.size() > 1)
 		{
@@ -18,10 +18,10 @@ bool TPlayer::msgPLI_VERIFYWANTSEND(CString& pPacket)
 
 	if (!ignoreChecksum)
 	{
-		CString fileData = server->getFileSystem()->load(fileName);
-		if (!fileData.isEmpty())
+		auto checksum = server->getFileCache().getChecksum(server->getFileSystem()->find(fileName));
+		if (checksum && checksum->size != 0)
 		{
-			if (calculateCrc32Checksum(fileData) == fileChecksum)
+			if (checksum->checksum == fileChecksum)
 			{
 				sendPacket(CString() >> (char)PLO_FILEUPTODATE << fileName);
 				return true;
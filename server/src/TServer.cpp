@@ -2,6 +2,7 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <algorithm>
 #include <functional>
 
 #include <fmt/format.h>
@@ -15,6 +16,7 @@
 #include "TMap.h"
 #include "TLevel.h"
 #include "ScriptOrigin.h"
+#include "utilities/stringutils.h"
 
 static const char* const filesystemTypes[] =
 {
@@ -46,7 +48,7 @@ CString operator<<(const CString& first, const CString& second)
 
 
 TServer::TServer(const CString& pName)
-	: running(false), doRestart(false), name(pName), serverlist(this), wordFilter(this), animationManager(this), packageManager(this), serverStartTime(0),
+	: running(false), doRestart(false), fileWatcher(this), name(pName), serverlist(this), wordFilter(this), animationManager(this), packageManager(this), serverStartTime(0),
 	triggerActionDispatcher(methodstub(this, &TServer::createTriggerCommands))
 #ifdef V8NPCSERVER
 	, mScriptEngine(this)
@@ -56,7 +58,7 @@ TServer::TServer(const CString& pName)
 #endif
 {
 	auto time_now = std::chrono::high_resolution_clock::now();
-	lastTimer = lastNWTimer = last1mTimer = last5mTimer = last3mTimer = time_now;
+	lastTimer = lastNWTimer = last1mTimer = last5mTimer = last3mTimer = lastFlushTimer = time_now;
 	calculateServerTime();
 
 	// Player ids 0 and 1 break things.  NPC id 0 breaks things.
@@ -92,8 +94,10 @@ TServer::TServer(const CString& pName)
 	// Announce ourself to other classes.
 	for (auto & fs : filesystem) {
 		fs.setServer(this);
+		fs.setWatcher(&fileWatcher);
 	}
 	filesystem_accounts.setServer(this);
+	filesystem_accounts.setWatcher(&fileWatcher);
 }
 
 TServer::~TServer()
@@ -113,6 +117,9 @@ int TServer::init(const CString& serverip, const CString& serverport, const CStr
 	}
 #endif
 
+	// Load file checksums from the last run.
+	loadChecksums();
+
 	// Load the config files.
 	int ret = loadConfigFiles();
 	if (ret) return ret;
@@ -292,6 +299,9 @@ void TServer::cleanup()
 	// Save server flags.
 	saveServerFlags();
 
+	// Save file checksums.
+	saveChecksums();
+
 #ifdef V8NPCSERVER
 	// Save npcs
 	saveNpcs();
@@ -309,6 +319,7 @@ void TServer::cleanup()
 	nextPlayerId = 2;
 
 	levelList.clear();
+	levelNameIndex.clear();
 	mapList.clear();
 	groupLevels.clear();
 
@@ -328,7 +339,7 @@ void TServer::cleanup()
 #endif
 
 	playerSock.disconnect();
-	serverlist.getSocket().disconnect();
+	serverlist.disconnect();
 
 	// Clean up the socket manager.  Pass false so we don't cause a crash.
 	sockManager.cleanup(false);
@@ -341,13 +352,31 @@ void TServer::restart()
 
 bool TServer::doMain()
 {
+	// Broadcast frames are only shared by the players that send them in the same tick.
+	broadcastFrameCache.clear();
+
 	// Update our socket manager.
+#ifdef __linux__
+	// Sleeps until socket activity or the wake-up timer armed below.
+	sockManager.update(1, 0);
+#else
 	sockManager.update(0, 5000);		// 5ms
+#endif
+
+	// Pick up files that were added or removed since the last update.
+	fileWatcher.update();
+	updateFileSystems();
+
+	// Keep the files that finished compressing.
+	precompressedFiles.update();
 
 	// Current time
 	auto currentTimer = std::chrono::high_resolution_clock::now();
 
 #ifdef V8NPCSERVER
+	// Resolve the promises of http requests that finished.
+	mScriptEngine.RunHttpRequests();
+
     mScriptEngine.RunScripts(currentTimer);
 
 	// enable when we switch to async compiling
@@ -362,9 +391,46 @@ bool TServer::doMain()
 		doTimedEvents();
 	}
 
+	// Send the packets queued for each player this pass, so they go out in as few frames as possible.
+	if (outboundLimits.flushPending && currentTimer - lastFlushTimer >= outboundLimits.flushInterval)
+	{
+		outboundLimits.flushPending = false;
+		lastFlushTimer = currentTimer;
+
+		for (auto& [id, player] : playerList)
+			player->flushPackets();
+	}
+
+#ifdef __linux__
+	// Wake up for the next timed events, or sooner if scripts have work scheduled.
+	auto nextWakeup = lastTimer + std::chrono::seconds(1);
+#ifdef V8NPCSERVER
+	nextWakeup = std::min(nextWakeup, mScriptEngine.getNextRunTime());
+#endif
+
+	// Held packets are sent on the next flush.
+	if (outboundLimits.flushPending)
+		nextWakeup = std::min(nextWakeup, lastFlushTimer + outboundLimits.flushInterval);
+
+	sockManager.setWakeup(nextWakeup - std::chrono::high_resolution_clock::now());
+#endif
+
 	return true;
 }
 
+void TServer::requestSend(CSocketStub* stub, std::chrono::nanoseconds delay)
+{
+#ifdef __linux__
+	if (delay.count() > 0)
+		sockManager.requestSend(stub, delay);
+	else sockManager.requestSend(stub);
+#else
+	// CSocketManager checks every socket on each update.
+	(void)stub;
+	(void)delay;
+#endif
+}
+
 bool TServer::doTimedEvents()
 {
 	// Do serverlist events.
@@ -417,6 +483,9 @@ bool TServer::doTimedEvents()
 
 		// Save server flags.
 		this->saveServerFlags();
+
+		// Save file checksums.
+		this->saveChecksums();
 	}
 
 	// Stuff that happens every 3 minutes.
@@ -425,12 +494,14 @@ bool TServer::doTimedEvents()
 	{
 		last3mTimer = lastTimer;
 
-		// TODO(joey): probably a better way to do this..
-
-		// Resynchronize the file systems.
-		filesystem_accounts.resync();
+		// Resynchronize the file systems that the watcher can't keep up to date.
+		if (!fileWatcher.isWatching(&filesystem_accounts))
+			filesystem_accounts.resync(true);
 		for (auto & i : filesystem)
-			i.resync();
+		{
+			if (!fileWatcher.isWatching(&i))
+				i.resync(true);
+		}
 	}
 
 	// Save stuff every 5 minutes.
@@ -502,23 +573,17 @@ bool TServer::onRecv()
 
 void TServer::loadAllFolders()
 {
-	for (auto & fs : filesystem)
-		fs.clear();
-
-	filesystem[0].addDir("world");
+	filesystem[0].queueDir("world");
 	if (settings.getStr("sharefolder").length() > 0)
 	{
 		std::vector<CString> folders = settings.getStr("sharefolder").tokenize(",");
 		for (auto & folder : folders)
-			filesystem[0].addDir(folder.trim());
+			filesystem[0].queueDir(folder.trim());
 	}
 }
 
 void TServer::loadFolderConfig()
 {
-	for (auto & i : filesystem)
-		i.clear();
-
 	foldersConfig = CString::loadToken(CString() << serverpath << "config/foldersconfig.txt", "\n", true);
 	for (auto & configLine : foldersConfig)
 	{
@@ -550,10 +615,10 @@ void TServer::loadFolderConfig()
 		// Add it to the appropriate file system.
 		if (fs != nullptr)
 		{
-			fs->addDir(dir, wildcard);
+			fs->queueDir(dir, wildcard);
 			serverlog.out("[%s]        adding %s [%s] to %s\n", name.text(), dir.text(), wildcard.text(), type.text());
 		}
-		filesystem[0].addDir(dir, wildcard);
+		filesystem[0].queueDir(dir, wildcard);
 	}
 }
 
@@ -604,6 +669,9 @@ int TServer::loadConfigFiles()
 	serverlog.out("[%s]      Loading classes...\n", name.text());
 	loadClasses(true);
 
+	// The maps are the first thing that needs the file system.
+	updateFileSystems(true);
+
 	// Load maps.
 	serverlog.out("[%s]      Loading maps...\n", name.text());
 	loadMaps(true);
@@ -645,6 +713,21 @@ void TServer::loadSettings()
 	// Load staff list
 	staffList = settings.getStr("staff").tokenize(",");
 
+	// Memory used to keep files that are sent to players, in megabytes.
+	fileCache.setMaxBytes((size_t)std::max(settings.getInt("filecachesize", 64), 0) * 1024 * 1024);
+
+	// How much a connection can send per tick.  File transfers are throttled to what gameplay packets leave, but always keep their share.
+	outboundLimits.tick = std::chrono::milliseconds(std::max(settings.getInt("outboundtick", 50), 1));
+	outboundLimits.bytesPerTick = std::max(settings.getInt("outboundbudget", 32), 0) * 1024;
+	outboundLimits.fileBytesPerTick = outboundLimits.bytesPerTick * clip(settings.getInt("outboundfileshare", 25), 0, 100) / 100;
+
+	// Gameplay packets are sent together at most this often, in milliseconds.
+	outboundLimits.flushInterval = std::chrono::milliseconds(clip(settings.getInt("flushinterval", 0), 0, 1000));
+
+	// Memory used to keep compressed copies of large files, in megabytes, and the smallest file size to compress ahead of time, in kilobytes.
+	precompressedFiles.setMaxBytes((size_t)std::max(settings.getInt("precompresscachesize", 32), 0) * 1024 * 1024);
+	precompressedFiles.setMinSize(std::max(settings.getInt("precompressminsize", 64), 0) * 1024);
+
 	// Send our ServerHQ info in case we got changed the staffonly setting.
 	getServerList().sendServerHQ();
 }
@@ -690,14 +773,23 @@ void TServer::loadAllowedVersions()
 
 void TServer::loadFileSystem()
 {
-	for (auto & i : filesystem)
-		i.clear();
-	filesystem_accounts.clear();
-	filesystem_accounts.addDir("accounts", "*.txt");
+	filesystem_accounts.queueDir("accounts", "*.txt");
 	if ( settings.getBool("nofoldersconfig", false))
 		loadAllFolders();
 	else
 		loadFolderConfig();
+
+	// Scan in the background, the current file lists are used until they finish.
+	filesystem_accounts.rebuild();
+	for (auto & i : filesystem)
+		i.rebuild();
+}
+
+void TServer::updateFileSystems(bool wait)
+{
+	filesystem_accounts.finishRebuild(wait);
+	for (auto & i : filesystem)
+		i.finishRebuild(wait);
 }
 
 void TServer::loadServerFlags()
@@ -963,6 +1055,17 @@ void TServer::saveServerFlags()
 	out.save(CString() << serverpath << "serverflags.txt");
 }
 
+void TServer::loadChecksums()
+{
+	fileCache.getChecksumIndex().load((CString() << serverpath << "checksums.txt").toString());
+}
+
+void TServer::saveChecksums()
+{
+	if (!fileCache.getChecksumIndex().save((CString() << serverpath << "checksums.txt").toString()))
+		serverlog.out("[%s] ** [Error] Could not save checksums.txt.\n", name.text());
+}
+
 void TServer::saveWeapons()
 {
 	CFileSystem weaponFS(this);
@@ -996,17 +1099,34 @@ void TServer::saveNpcs()
 	}
 }
 
-std::vector<std::pair<double, std::string>> TServer::calculateNpcStats()
+std::vector<std::pair<std::string, ScriptProfileStats>> TServer::calculateNpcStats(bool perEvent)
 {
-	std::vector<std::pair<double, std::string>> script_profiles;
+	std::vector<std::pair<std::string, ScriptProfileStats>> script_profiles;
+
+	// The name is only put together for scripts that ran.
+	auto addProfiles = [&script_profiles, perEvent](const ScriptExecutionContext& context, auto getScriptName)
+	{
+		if (!perEvent)
+		{
+			auto stats = context.getProfileStats();
+			if (stats.calls > 0)
+				script_profiles.emplace_back(getScriptName(), stats);
+			return;
+		}
+
+		auto eventStats = context.getEventProfileStats();
+		if (eventStats.empty())
+			return;
+
+		std::string scriptName = getScriptName();
+		for (auto& [event, stats] : eventStats)
+			script_profiles.emplace_back(scriptName + ": " + (event.empty() ? "(script)" : event), stats);
+	};
 
 	// Iterate npcs
 	for (const auto& [npcId, npc] : npcList)
 	{
-		ScriptExecutionContext& context = npc->getExecutionContext();
-		std::pair<unsigned int, double> executionData = context.getExecutionData();
-		if (executionData.second > 0.0)
-		{
+		addProfiles(npc->getExecutionContext(), [&npc = npc]() {
 			std::string npcName = npc->getName();
 			if (npcName.empty())
 				npcName = "Level npc " + std::to_string(npc->getId());
@@ -1017,26 +1137,22 @@ std::vector<std::pair<double, std::string>> TServer::calculateNpcStats()
 					append(" at pos (").append(CString(npc->getY() / 16.0).text()).
 					append(", ").append(CString(npc->getX() / 16.0).text()).append(")");
 			}
-
-			script_profiles.push_back(std::make_pair(executionData.second, npcName));
-		}
+			return npcName;
+		});
 	}
 
 	// Iterate weapons
 	for (const auto& [weaponName, weapon] : weaponList)
-	{
-		ScriptExecutionContext& context = weapon->getExecutionContext();
-		std::pair<unsigned int, double> executionData = context.getExecutionData();
+		addProfiles(weapon->getExecutionContext(), [&weaponName = weaponName]() { return "Weapon " + weaponName; });
 
-		if (executionData.second > 0.0)
-		{
-			std::string weaponName("Weapon ");
-			weaponName.append(weaponName);
-			script_profiles.push_back(std::make_pair(executionData.second, weaponName));
-		}
-	}
+	// Promise handlers of http requests, which run together when the requests finish
+	auto httpStats = mScriptEngine.getHttpProfile().getStats(std::chrono::high_resolution_clock::now());
+	if (httpStats.calls > 0)
+		script_profiles.emplace_back(perEvent ? "Http requests: promise handlers" : "Http requests", httpStats);
 
-	std::sort(script_profiles.rbegin(), script_profiles.rend());
+	std::sort(script_profiles.begin(), script_profiles.end(), [](const auto& a, const auto& b) {
+		return a.second.total > b.second.total;
+	});
 	return script_profiles;
 }
 #endif
@@ -1115,6 +1231,23 @@ std::shared_ptr<TLevel> TServer::getLevel(const std::string& pLevel)
 	return TLevel::findLevel(pLevel, this);
 }
 
+std::shared_ptr<TLevel> TServer::findLoadedLevel(const CString& pLevelName) const
+{
+	auto it = levelNameIndex.find(utilities::foldCase(pLevelName));
+	if (it == levelNameIndex.end())
+		return nullptr;
+
+	return it->second;
+}
+
+void TServer::addLevel(const std::shared_ptr<TLevel>& pLevel)
+{
+	levelList.push_back(pLevel);
+
+	// Keep the first level loaded under a name, the same one a search of the level list would find.
+	levelNameIndex.emplace(utilities::foldCase(pLevel->getLevelName()), pLevel);
+}
+
 std::shared_ptr<TWeapon> TServer::getWeapon(const std::string& name)
 {
 	auto iter = weaponList.find(name);
@@ -1538,6 +1671,9 @@ bool TServer::setFlag(const std::string& pFlagName, const CString& pFlagValue, b
 
 void TServer::sendPacketToAll(const CString& packet, const std::set<uint16_t>& exclude) const
 {
+	auto sharedPacket = makeSharedPacket(packet);
+	if (!sharedPacket) return;
+
 	for (auto& [id, player] : playerList)
 	{
 		if (exclude.contains(id))
@@ -1545,7 +1681,7 @@ void TServer::sendPacketToAll(const CString& packet, const std::set<uint16_t>& e
 		if (player->isNPCServer())
 			continue;
 
-		player->sendPacket(packet);
+		player->sendPacket(sharedPacket);
 	}
 }
 
@@ -1554,6 +1690,9 @@ void TServer::sendPacketToLevelArea(const CString& packet, std::weak_ptr<TLevel>
 	auto levelp = level.lock();
 	if (!levelp) return;
 
+	auto sharedPacket = makeSharedPacket(packet);
+	if (!sharedPacket) return;
+
 	// If we have no map, just send to the level players.
 	auto map = levelp->getMap();
 	if (!map)
@@ -1562,27 +1701,21 @@ void TServer::sendPacketToLevelArea(const CString& packet, std::weak_ptr<TLevel>
 		{
 			if (exclude.contains(id)) continue;
 			if (auto other = this->getPlayer(id); other->isClient() && (sendIf == nullptr || sendIf(other.get())))
-				other->sendPacket(packet);
+				other->sendPacket(sharedPacket);
 		}
 	}
 	else
 	{
-		std::pair<int, int> sgmap{ levelp->getMapX(), levelp->getMapY() };
+		// Only visit the players in the surrounding levels.
+		map->forEachPlayerNear(levelp->getMapX(), levelp->getMapY(), nullptr, [&](uint16_t id) {
+			if (exclude.contains(id)) return;
 
-		for (auto& [id, other] : playerList)
-		{
-			if (exclude.contains(id)) continue;
-			if (!other->isClient()) continue;
-			if (sendIf != nullptr && !sendIf(other.get())) continue;
-
-			auto othermap = other->getMap().lock();
-			if (!othermap || othermap != map) continue;
+			auto other = this->getPlayer(id);
+			if (!other || !other->isClient()) return;
+			if (sendIf != nullptr && !sendIf(other.get())) return;
 
-			// Check if they are nearby before sending the packet.
-			auto ogmap{ other->getMapPosition() };
-			if (abs(ogmap.first - sgmap.first) < 2 && abs(ogmap.second - sgmap.second) < 2)
-				other->sendPacket(packet);
-		}
+			other->sendPacket(sharedPacket);
+		});
 	}
 }
 
@@ -1594,6 +1727,9 @@ void TServer::sendPacketToLevelArea(const CString& packet, std::weak_ptr<TPlayer
 	auto level = playerp->getLevel();
 	if (!level) return;
 
+	auto sharedPacket = makeSharedPacket(packet);
+	if (!sharedPacket) return;
+
 	// If we have no map, just send to the level players.
 	auto map = level->getMap();
 	if (!map)
@@ -1602,29 +1738,23 @@ void TServer::sendPacketToLevelArea(const CString& packet, std::weak_ptr<TPlayer
 		{
 			if (exclude.contains(id)) continue;
 			if (auto other = this->getPlayer(id); other->isClient() && (sendIf == nullptr || sendIf(other.get())))
-				other->sendPacket(packet);
+				other->sendPacket(sharedPacket);
 		}
 	}
 	else
 	{
-		auto isGroupMap = map->isGroupMap();
 		auto sgmap{ playerp->getMapPosition() };
 
-		for (auto& [id, other] : playerList)
-		{
-			if (exclude.contains(id)) continue;
-			if (!other->isClient()) continue;
-			if (sendIf != nullptr && !sendIf(other.get())) continue;
+		// Only visit the players in the surrounding levels.
+		map->forEachPlayerNear(sgmap.first, sgmap.second, &playerp->getMapGroup(), [&](uint16_t id) {
+			if (exclude.contains(id)) return;
 
-			auto othermap = other->getMap().lock();
-			if (!othermap || othermap != map) continue;
-			if (isGroupMap && playerp->getGroup() != other->getGroup()) continue;
+			auto other = this->getPlayer(id);
+			if (!other || !other->isClient()) return;
+			if (sendIf != nullptr && !sendIf(other.get())) return;
 
-			// Check if they are nearby before sending the packet.
-			auto ogmap{ other->getMapPosition() };
-			if (abs(ogmap.first - sgmap.first) < 2 && abs(ogmap.second - sgmap.second) < 2)
-				other->sendPacket(packet);
-		}
+			other->sendPacket(sharedPacket);
+		});
 	}
 }
 
@@ -1633,11 +1763,14 @@ void TServer::sendPacketToOneLevel(const CString& packet, std::weak_ptr<TLevel>
 	auto levelp = level.lock();
 	if (!levelp) return;
 
+	auto sharedPacket = makeSharedPacket(packet);
+	if (!sharedPacket) return;
+
 	for (auto id: levelp->getPlayerList())
 	{
 		if (exclude.contains(id)) continue;
 		if (auto player = this->getPlayer(id); player->isClient())
-			player->sendPacket(packet);
+			player->sendPacket(sharedPacket);
 	}
 }
 
@@ -1652,10 +1785,14 @@ void TServer::sendPacketToType(int who, const CString& pPacket, std::weak_ptr<TP
 void TServer::sendPacketToType(int who, const CString& pPacket, TPlayer* pPlayer) const
 {
 	if (!running) return;
+
+	auto sharedPacket = makeSharedPacket(pPacket);
+	if (!sharedPacket) return;
+
 	for (auto& [id, player] : playerList)
 	{
 		if ((player->getType() & who) && (!pPlayer || id != pPlayer->getId()))
-			player->sendPacket(pPacket);
+			player->sendPacket(sharedPacket);
 	}
 }
 
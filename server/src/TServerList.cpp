@@ -1,4 +1,5 @@
 #include <fmt/format.h>
+#include <thread>
 
 #include "IDebug.h"
 #include "IConfig.h"
@@ -51,15 +52,24 @@ void TServerList::createFunctions()
 	TServerList::created = true;
 }
 
+static std::unique_ptr<CSocket> createListServerSocket()
+{
+	auto sock = std::make_unique<CSocket>();
+	sock->setProtocol(SOCKET_PROTOCOL_TCP);
+	sock->setType(SOCKET_TYPE_CLIENT);
+	sock->setDescription("listserver");
+	return sock;
+}
+
 /*
 	Constructor - Deconstructor
 */
 TServerList::TServerList(TServer *server)
-	: _server(server), _fileQueue(&sock), nextIsRaw(false), rawPacketSize(0), _serverRemoteIp("127.0.0.1"), connectionAttempts(0), nextConnectionAttempt(0)
+	: _server(server), nextIsRaw(false), rawPacketSize(0), _serverRemoteIp("127.0.0.1"), connectionAttempts(0), nextConnectionAttempt(0)
 {
-	sock.setProtocol(SOCKET_PROTOCOL_TCP);
-	sock.setType(SOCKET_TYPE_CLIENT);
-	sock.setDescription("listserver");
+	sock = createListServerSocket();
+	_fileQueue = std::make_unique<CFileQueue>(sock.get());
+	connectDone = std::make_shared<WakeupEvent>([this]() { checkConnect(); });
 
 	lastData = lastTimer = time(0);
 
@@ -77,17 +87,20 @@ TServerList::~TServerList()
 */
 bool TServerList::getConnected() const
 {
-	return (sock.getState() == SOCKET_STATE_CONNECTED);
+	if (isConnecting())
+		return false;
+
+	return (sock->getState() == SOCKET_STATE_CONNECTED);
 }
 
 bool TServerList::onRecv()
 {
 	// Grab the data from the socket and put it into our receive buffer.
 	unsigned int size = 0;
-	char* data = sock.getData(&size);
+	char* data = sock->getData(&size);
 	if (size != 0)
 		readBuffer.write(data, size);
-	else if (sock.getState() == SOCKET_STATE_DISCONNECTED)
+	else if (sock->getState() == SOCKET_STATE_DISCONNECTED)
 		return false;
 
 	main();
@@ -97,19 +110,20 @@ bool TServerList::onRecv()
 
 bool TServerList::onSend()
 {
-	_fileQueue.sendCompress();
+	_fileQueue->sendCompress();
 	return true;
 }
 
 bool TServerList::canRecv()
 {
-	if (sock.getState() == SOCKET_STATE_DISCONNECTED) return false;
+	if (isConnecting()) return false;
+	if (sock->getState() == SOCKET_STATE_DISCONNECTED) return false;
 	return true;
 }
 
 void TServerList::onUnregister()
 {
-	_server->getServerLog().out("[%s] :: %s - Disconnected.\n", _server->getName().text(), sock.getDescription());
+	_server->getServerLog().out("[%s] :: %s - Disconnected.\n", _server->getName().text(), sock->getDescription());
 }
 
 bool TServerList::main()
@@ -121,20 +135,21 @@ bool TServerList::main()
 	CString unBuffer;
 
 	// parse data
-	readBuffer.setRead(0);
 	while (readBuffer.length() > 1)
 	{
 		// New data.
 		lastData = time(0);
 
 		// packet length
-		unsigned short len = (unsigned short)readBuffer.readShort();
+		unsigned short len = readBuffer.peekShort();
 		if ((unsigned int)len > (unsigned int)readBuffer.length() - 2)
 			break;
 
 		// decompress packet
-		unBuffer = readBuffer.readChars(len);
-		readBuffer.removeI(0, len + 2);
+		auto frame = readBuffer.view(2, len);
+		unBuffer.clear(len);
+		unBuffer.write(frame.data(), (int)frame.size());
+		readBuffer.consume(len + 2);
 		unBuffer.zuncompressI();
 
 		// well theres your buffer
@@ -152,55 +167,118 @@ bool TServerList::doTimedEvents()
 {
 	lastTimer = time(0);
 
-	bool isConnected = getConnected();
-
-	if (!isConnected)
+	// Wait for the connection to the listserver to finish in the background.
+	if (isConnecting())
 	{
-		// Reconnect to the listserver, with connection backoff to prevent a flood of connections
-		if (difftime(lastTimer, nextConnectionAttempt) >= 0)
-		{
-			if (!connectServer())
-			{
-				if (connectionAttempts < 8)
-					connectionAttempts += 1;
-
-				auto waitTime = std::min(uint32_t(std::pow(2u, connectionAttempts)), 300u);
-				nextConnectionAttempt = lastTimer + waitTime + (rand() % 5);
-			}
-			else connectionAttempts = 0;
-		}
+		checkConnect();
+		return true;
 	}
 
+	// Reconnect to the listserver, with connection backoff to prevent a flood of connections
+	if (!getConnected() && difftime(lastTimer, nextConnectionAttempt) >= 0)
+		connectServer();
+
 	return true;
 }
 
+void TServerList::checkConnect()
+{
+	if (!isConnecting() || pendingConnect->result == CONNECT_PENDING)
+		return;
+
+	if (finishConnect())
+		connectionAttempts = 0;
+	else scheduleReconnect();
+}
+
+void TServerList::scheduleReconnect()
+{
+	if (connectionAttempts < 8)
+		connectionAttempts += 1;
+
+	auto waitTime = std::min(uint32_t(std::pow(2u, connectionAttempts)), 300u);
+	nextConnectionAttempt = lastTimer + waitTime + (rand() % 5);
+}
+
 bool TServerList::connectServer()
 {
 	auto& settings = _server->getSettings();
 
-	if (getConnected())
+	if (getConnected() || isConnecting())
 		return true;
 
-	auto& serverLog = _server->getServerLog();
+	_server->getServerLog().out("[%s] :: Initializing %s socket.\n", _server->getName().text(), sock->getDescription());
 
-	serverLog.out("[%s] :: Initializing %s socket.\n", _server->getName().text(), sock.getDescription());
+	// Resolving and connecting can take as long as the connect timeout, so do it on another
+	// thread. It only shares the attempt with us, so it can outlive the server list.
+	std::string host = settings.getStr("listip").text();
+	std::string port = settings.getStr("listport").text();
+	auto attempt = std::make_shared<ConnectAttempt>();
+	attempt->sock = createListServerSocket();
+	pendingConnect = attempt;
 
-	// Initialize the socket
-	if (sock.init(settings.getStr("listip").text(), settings.getStr("listport").text()) != 0)
-	{
-		serverLog.out("[%s] :: [Error] Could not initialize %s socket.\n", _server->getName().text(), sock.getDescription());
-		return false;
-	}
+	// Registering again is a no-op, the event stays registered between attempts.
+	if (connectDone->isValid())
+		_server->getSocketManager().registerSocket(connectDone.get());
+
+	std::thread([attempt, done = connectDone, host, port]() {
+		// Initialize the socket
+		if (attempt->sock->init(host.c_str(), port.c_str()) != 0)
+			attempt->result = CONNECT_INITFAILED;
+
+		// Connect to Server
+		else if (attempt->sock->connect() != 0)
+			attempt->result = CONNECT_FAILED;
+
+		else attempt->result = CONNECT_OK;
 
-	// Connect to Server
-	if (sock.connect() != 0)
+		done->signal();
+	}).detach();
+
+	return true;
+}
+
+bool TServerList::finishConnect()
+{
+	auto& serverLog = _server->getServerLog();
+
+	auto attempt = std::move(pendingConnect);
+	switch (attempt->result)
 	{
-		serverLog.out("[%s] :: [Error] Could not connect %s socket.\n", _server->getName().text(), sock.getDescription());
-		return false;
+		case CONNECT_INITFAILED:
+			serverLog.out("[%s] :: [Error] Could not initialize %s socket.\n", _server->getName().text(), sock->getDescription());
+			return false;
+
+		case CONNECT_FAILED:
+			serverLog.out("[%s] :: [Error] Could not connect %s socket.\n", _server->getName().text(), sock->getDescription());
+			return false;
 	}
 
+	// Take over the connected socket.  Anything queued for the old one is cleared by the handshake.
+	sock = std::move(attempt->sock);
+	_fileQueue = std::make_unique<CFileQueue>(sock.get());
+
 	_server->getSocketManager().registerSocket((CSocketStub*)this);
-	serverLog.out("[%s] :: %s - Connected.\n", _server->getName().text(), sock.getDescription());
+	serverLog.out("[%s] :: %s - Connected.\n", _server->getName().text(), sock->getDescription());
+
+	sendHandshake();
+
+	// Return Connection-Status
+	return getConnected();
+}
+
+void TServerList::disconnect()
+{
+	// Don't wait for a connection in progress, its thread closes the socket when it finishes.
+	pendingConnect.reset();
+
+	sock->disconnect();
+}
+
+void TServerList::sendHandshake()
+{
+	auto& settings = _server->getSettings();
+	auto& serverLog = _server->getServerLog();
 
 	// Get Some Stuff
 	CString name(settings.getStr("name"));
@@ -214,7 +292,7 @@ bool TServerList::connectServer()
 
 	// Grab the local ip.
 	if (localip.isEmpty() || localip == "AUTO")
-		localip = sock.getLocalIp();
+		localip = sock->getLocalIp();
 	if (localip == "127.0.1.1" || localip == "127.0.0.1")
 	{
 		serverLog.out(CString() << "[" << _server->getName().text() << "] ** [WARNING] Socket returned " << localip << " for its local ip!  Not sending local ip to serverlist.\n");
@@ -223,12 +301,12 @@ bool TServerList::connectServer()
 
 	// TODO(joey): Some packets were being queued up from the server before we were connected, and would spam the serverlist
 	// upon connection. Clearing the outgoing buffer upon connection
-	_fileQueue.clearBuffers();
+	_fileQueue->clearBuffers();
 
 	// Use the new protocol for communicating with the listserver
-	_fileQueue.setCodec(ENCRYPT_GEN_1, 0);
+	_fileQueue->setCodec(ENCRYPT_GEN_1, 0);
 	sendPacket(CString() >> (char)SVO_REGISTERV3 << version, true);
-	_fileQueue.setCodec(ENCRYPT_GEN_2, 0);
+	_fileQueue->setCodec(ENCRYPT_GEN_2, 0);
 
 	// Send before SVO_NEWSERVER or else we will get an incorrect name.
 	auto& adminsettings = _server->getAdminSettings();
@@ -254,9 +332,6 @@ bool TServerList::connectServer()
 
 	// Send Players
 	sendPlayers();
-
-	// Return Connection-Status
-	return getConnected();
 }
 
 void TServerList::sendVersionConfig()
@@ -289,11 +364,12 @@ void TServerList::sendPacket(CString& pPacket, bool sendNow)
 		pPacket.writeChar('\n');
 
 	// append buffer
-	_fileQueue.addPacket(pPacket);
+	_fileQueue->addPacket(pPacket);
 
 	// send buffer now?
 	if (sendNow)
-		_fileQueue.sendCompress();
+		_fileQueue->sendCompress();
+	else _server->requestSend(this);
 }
 
 /*
@@ -674,7 +750,7 @@ void TServerList::msgSVI_PROFILE(CString& pPacket)
 
 void TServerList::msgSVI_ERRMSG(CString& pPacket)
 {
-	_server->getServerLog().out("[%s] :: %s - [Error] %s\n", _server->getName().text(), sock.getDescription(), pPacket.readString("").text());
+	_server->getServerLog().out("[%s] :: %s - [Error] %s\n", _server->getName().text(), sock->getDescription(), pPacket.readString("").text());
 }
 
 void TServerList::msgSVI_VERIACC2(CString& pPacket)
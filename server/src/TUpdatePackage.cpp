@@ -6,15 +6,19 @@
 std::optional<TUpdatePackage> TUpdatePackage::load(TServer* const server, const std::string& name)
 {
 	auto fileSystem = server->getFileSystem();
+	auto& fileCache = server->getFileCache();
 
 	// Search for the file in the filesystem, and load the contents
-	auto fileContents = fileSystem->load(name);
-	if (fileContents.isEmpty())
+	CString packagePath = fileSystem->find(name);
+	auto packageFile = fileCache.get(packagePath);
+	if (!packageFile || packageFile->data.isEmpty())
 		return std::nullopt;
+
+	const CString& fileContents = packageFile->data;
 	
 	// Calculate the checksum for the gupd file
 	TUpdatePackage updatePackage(name);
-	updatePackage.checksum = calculateCrc32Checksum(fileContents);
+	updatePackage.checksum = fileCache.getChecksum(packagePath).value_or(FileChecksum{}).checksum;
 	
 	// Calculate the checksum and filesize for each file referenced in the package
 	auto packageLines = fileContents.tokenize("\n");
@@ -28,17 +32,18 @@ std::optional<TUpdatePackage> TUpdatePackage::load(TServer* const server, const
 			std::string filePath = line.subString(4).trim().toString();
 			std::string baseFileName = std::filesystem::path(filePath).filename().string();
 			
-			CString updateFileData = fileSystem->load(baseFileName);
+			// Checksums are usually known already, so the file doesn't have to be read
+			auto updateFile = fileCache.getChecksum(fileSystem->find(baseFileName));
 			
 			// File was not found in the filesystem
-			if (updateFileData.isEmpty())
+			if (!updateFile || updateFile->size == 0)
 				continue;
 			
-			uint32_t fileLength(updateFileData.length());
+			uint32_t fileLength(updateFile->size);
 			
 			updatePackage.fileList.emplace(baseFileName, FileEntry{
 				.size = fileLength,
-				.checksum = calculateCrc32Checksum(updateFileData)
+				.checksum = updateFile->checksum
 			});
 			
 			updatePackage.packageSize += fileLength;
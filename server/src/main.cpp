@@ -27,53 +27,9 @@
 // Function pointer for signal handling.
 typedef void (*sighandler_t)(int);
 
-// Home path of the gserver.
-CString homePath;
-static void getBasePath();
-std::string getBaseHomePath()
-{
-	return homePath.text();
-}
-
-void getBasePath()
-{
-#if defined(_WIN32) || defined(_WIN64)
-	// Get the path.
-	char path[ MAX_PATH ];
-	GetCurrentDirectoryA(MAX_PATH,path);
-
-	// Find the program exe and remove it from the path.
-	// Assign the path to homepath.
-	homePath = path;
-	homePath += "\\";
-	int pos = homePath.findl('\\');
-	if (pos == -1) homePath.clear();
-	else if (pos != (homePath.length() - 1))
-		homePath.removeI(++pos, homePath.length());
-#elif __APPLE__
-	char path[255];
-	if (!getcwd(path, sizeof(path)))
-		printf("Error getting CWD\n");
-
-	homePath = path;
-	if (homePath[homePath.length() - 1] != '/')
-		homePath << '/';
-#else
-	// Get the path to the program.
-	char path[260];
-	memset((void*)path, 0, 260);
-	readlink("/proc/self/exe", path, sizeof(path));
-
-	// Assign the path to homepath.
-	char* end = strrchr(path, '/');
-	if (end != 0)
-	{
-		end++;
-		if (end != 0) *end = '\0';
-		homePath = path;
-	}
-#endif
-}
+// Home path of the gserver, and the shutdown flag, live in ServerGlobals.cpp so the server
+// library links without this file.
+extern std::atomic_bool shutdownProgram;
 
 CLog serverlog("startuplog.txt");
 CString overrideServer;
@@ -84,9 +40,6 @@ CString overrideServerInterface = nullptr;
 CString overrideName = nullptr;
 CString overrideStaff = nullptr;
 
-std::atomic_bool shutdownProgram{ false };
-
-#ifndef NOMAIN
 int main(int argc, char* argv[])
 {
 	if (parseArgs(argc, argv))
@@ -211,7 +164,7 @@ int main(int argc, char* argv[])
 
 	return ERR_SUCCESS;
 }
-#endif
+
 /*
 	Extra-Cool Functions :D
 */
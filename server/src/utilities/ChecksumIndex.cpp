@@ -0,0 +1,100 @@
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+
+#include "ChecksumIndex.h"
+
+std::optional<uint32_t> ChecksumIndex::find(const std::string& path, long long size, time_t modTime) const
+{
+	auto it = entries.find(path);
+	if (it == entries.end() || it->second.size != size || it->second.modTime != modTime)
+		return std::nullopt;
+
+	return it->second.checksum;
+}
+
+void ChecksumIndex::add(const std::string& path, long long size, time_t modTime, uint32_t checksum)
+{
+	entries[path] = Entry{ size, modTime, checksum };
+	dirty = true;
+}
+
+size_t ChecksumIndex::prune()
+{
+	size_t removed = 0;
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		struct stat fileStat{};
+		if (stat(it->first.c_str(), &fileStat) == -1 || (long long)fileStat.st_size != it->second.size || fileStat.st_mtime != it->second.modTime)
+		{
+			it = entries.erase(it);
+			++removed;
+		}
+		else ++it;
+	}
+
+	if (removed > 0)
+		dirty = true;
+	return removed;
+}
+
+void ChecksumIndex::clear()
+{
+	dirty = !entries.empty();
+	entries.clear();
+}
+
+bool ChecksumIndex::load(const std::string& file)
+{
+	std::ifstream in(file);
+	if (!in)
+		return false;
+
+	entries.clear();
+
+	// One file per line: checksum size modtime path
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		uint32_t checksum;
+		long long size, modTime;
+		if (!(fields >> checksum >> size >> modTime))
+			continue;
+
+		// The path is the rest of the line, and may contain spaces.
+		std::string path;
+		fields.get();
+		std::getline(fields, path);
+		if (!path.empty() && path.back() == '\r')
+			path.pop_back();
+		if (path.empty())
+			continue;
+
+		entries[path] = Entry{ size, (time_t)modTime, checksum };
+	}
+
+	// Files deleted or changed while the server was down would otherwise be kept forever.
+	dirty = false;
+	prune();
+	return true;
+}
+
+bool ChecksumIndex::save(const std::string& file)
+{
+	if (!dirty)
+		return true;
+
+	std::ofstream out(file, std::ios::trunc);
+	if (!out)
+		return false;
+
+	for (const auto& [path, entry] : entries)
+		out << entry.checksum << ' ' << entry.size << ' ' << (long long)entry.modTime << ' ' << path << '\n';
+
+	if (!out)
+		return false;
+
+	dirty = false;
+	return true;
+}
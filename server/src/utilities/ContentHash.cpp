@@ -0,0 +1,87 @@
+#include <cstring>
+
+#include "ContentHash.h"
+
+namespace utilities
+{
+	namespace
+	{
+		constexpr uint64_t C1 = 0x87c37b91114253d5ull;
+		constexpr uint64_t C2 = 0x4cf5ad432745937full;
+
+		inline uint64_t rotl(uint64_t x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+		inline uint64_t fmix(uint64_t k)
+		{
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdull;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ull;
+			k ^= k >> 33;
+			return k;
+		}
+	}
+
+	ContentHash contentHash(const char* data, size_t length)
+	{
+		auto p = (const unsigned char*)data;
+		uint64_t h1 = 0, h2 = 0;
+
+		// Body, 16 bytes at a time.
+		size_t blocks = length / 16;
+		for (size_t i = 0; i < blocks; i++, p += 16)
+		{
+			uint64_t k1, k2;
+			std::memcpy(&k1, p, sizeof(k1));
+			std::memcpy(&k2, p + 8, sizeof(k2));
+
+			k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1 ^= k1;
+			h1 = rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+			k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2 ^= k2;
+			h2 = rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+		}
+
+		// Tail, the remaining 0-15 bytes.
+		uint64_t k1 = 0, k2 = 0;
+		switch (length & 15)
+		{
+			case 15: k2 ^= (uint64_t)p[14] << 48; [[fallthrough]];
+			case 14: k2 ^= (uint64_t)p[13] << 40; [[fallthrough]];
+			case 13: k2 ^= (uint64_t)p[12] << 32; [[fallthrough]];
+			case 12: k2 ^= (uint64_t)p[11] << 24; [[fallthrough]];
+			case 11: k2 ^= (uint64_t)p[10] << 16; [[fallthrough]];
+			case 10: k2 ^= (uint64_t)p[9] << 8; [[fallthrough]];
+			case 9:  k2 ^= (uint64_t)p[8];
+				k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2 ^= k2;
+				[[fallthrough]];
+			case 8:  k1 ^= (uint64_t)p[7] << 56; [[fallthrough]];
+			case 7:  k1 ^= (uint64_t)p[6] << 48; [[fallthrough]];
+			case 6:  k1 ^= (uint64_t)p[5] << 40; [[fallthrough]];
+			case 5:  k1 ^= (uint64_t)p[4] << 32; [[fallthrough]];
+			case 4:  k1 ^= (uint64_t)p[3] << 24; [[fallthrough]];
+			case 3:  k1 ^= (uint64_t)p[2] << 16; [[fallthrough]];
+			case 2:  k1 ^= (uint64_t)p[1] << 8; [[fallthrough]];
+			case 1:  k1 ^= (uint64_t)p[0];
+				k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1 ^= k1;
+		}
+
+		// Finalization.
+		h1 ^= length;
+		h2 ^= length;
+
+		h1 += h2;
+		h2 += h1;
+
+		h1 = fmix(h1);
+		h2 = fmix(h2);
+
+		h1 += h2;
+		h2 += h1;
+
+		return ContentHash{ h1, h2 };
+	}
+}
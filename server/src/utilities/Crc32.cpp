@@ -0,0 +1,81 @@
+#include <array>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#include <cstring>
+#endif
+
+#include "Crc32.h"
+
+namespace utilities
+{
+#if defined(__ARM_FEATURE_CRC32)
+	uint32_t crc32(const char* data, size_t length, uint32_t crc)
+	{
+		auto p = (const unsigned char*)data;
+		crc = ~crc;
+
+		while (length >= 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, p, sizeof(word));
+			crc = __crc32d(crc, word);
+			p += 8;
+			length -= 8;
+		}
+
+		while (length-- > 0)
+			crc = __crc32b(crc, *p++);
+
+		return ~crc;
+	}
+#else
+	// Table k gives the effect of a byte followed by k zero bytes, so eight bytes
+	// can be folded in with independent lookups.
+	static constexpr auto makeCrcTables()
+	{
+		std::array<std::array<uint32_t, 256>, 8> tables{};
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			tables[0][i] = c;
+		}
+
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			for (size_t k = 1; k < tables.size(); ++k)
+				tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+		}
+
+		return tables;
+	}
+
+	static constexpr auto crcTables = makeCrcTables();
+
+	uint32_t crc32(const char* data, size_t length, uint32_t crc)
+	{
+		const auto& t = crcTables;
+		auto p = (const unsigned char*)data;
+		crc = ~crc;
+
+		while (length >= 8)
+		{
+			uint32_t one = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+			uint32_t two = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+
+			crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24]
+				^ t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+
+			p += 8;
+			length -= 8;
+		}
+
+		while (length-- > 0)
+			crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+
+		return ~crc;
+	}
+#endif
+}
@@ -0,0 +1,319 @@
+#ifdef __linux__
+
+#include <algorithm>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+#include "EpollSocketManager.h"
+
+// Tag used for the wake-up timer in the epoll user data.
+static constexpr uint64_t TIMER_ID = 0;
+
+// Maximum events dequeued by a single epoll_wait call.
+static constexpr int MAX_EVENTS = 256;
+
+static short pollSocket(int handle, short events)
+{
+	pollfd pfd{ handle, events, 0 };
+	if (::poll(&pfd, 1, 0) <= 0)
+		return 0;
+	return pfd.revents;
+}
+
+EpollSocketManager::EpollSocketManager()
+	: epollFd(-1), timerFd(-1), nextId(TIMER_ID + 1), sendingId(TIMER_ID)
+{
+	epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+	timerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	if (epollFd >= 0 && timerFd >= 0)
+	{
+		epoll_event ev{};
+		ev.events = EPOLLIN;
+		ev.data.u64 = TIMER_ID;
+		::epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &ev);
+	}
+}
+
+EpollSocketManager::~EpollSocketManager()
+{
+	cleanup(false);
+
+	if (timerFd >= 0)
+		::close(timerFd);
+	if (epollFd >= 0)
+		::close(epollFd);
+}
+
+void EpollSocketManager::cleanup(bool callOnUnregister)
+{
+	while (!entries.empty())
+		dropSocket(entries.begin()->first, callOnUnregister);
+}
+
+bool EpollSocketManager::registerSocket(CSocketStub* stub)
+{
+	if (stub == nullptr || epollFd < 0)
+		return false;
+
+	int handle = (int)stub->getSocketHandle();
+	if (handle < 0)
+		return false;
+
+	// Already registered, but the stub may have reconnected on a new handle.
+	auto it = stubIds.find(stub);
+	if (it != stubIds.end())
+	{
+		if (entries[it->second].handle == handle)
+			return true;
+		dropSocket(it->second, false);
+	}
+
+	if (!stub->onRegister())
+		return false;
+
+	uint64_t id = nextId++;
+
+	// Level-triggered, so data left over after a single onRecv() is reported again on the next pass.
+	epoll_event ev{};
+	ev.events = EPOLLIN | EPOLLRDHUP;
+	ev.data.u64 = id;
+	if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, handle, &ev) != 0)
+		return false;
+
+	// Output may have been queued before we registered, so give it a chance to send.
+	auto& entry = entries[id];
+	entry = SocketEntry{ stub, handle, false, false, clock::time_point::max() };
+	stubIds[stub] = id;
+	markReady(entry, id);
+	return true;
+}
+
+bool EpollSocketManager::unregisterSocket(CSocketStub* stub)
+{
+	auto it = stubIds.find(stub);
+	if (it == stubIds.end())
+		return false;
+
+	dropSocket(it->second, false);
+	return true;
+}
+
+void EpollSocketManager::dropSocket(uint64_t id, bool callOnUnregister)
+{
+	auto it = entries.find(id);
+	if (it == entries.end())
+		return;
+
+	CSocketStub* stub = it->second.stub;
+
+	// The handle may already be closed, in which case the kernel has removed it for us.
+	// Ready and timed entries are skipped once the id is gone.
+	::epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.handle, nullptr);
+	stubIds.erase(stub);
+	entries.erase(it);
+
+	if (callOnUnregister)
+		stub->onUnregister();
+}
+
+void EpollSocketManager::setWatchWrite(SocketEntry& entry, uint64_t id, bool watch)
+{
+	if (entry.watchWrite == watch)
+		return;
+
+	epoll_event ev{};
+	ev.events = EPOLLIN | EPOLLRDHUP | (watch ? EPOLLOUT : 0);
+	ev.data.u64 = id;
+	if (::epoll_ctl(epollFd, EPOLL_CTL_MOD, entry.handle, &ev) == 0)
+		entry.watchWrite = watch;
+}
+
+void EpollSocketManager::markReady(SocketEntry& entry, uint64_t id)
+{
+	if (!entry.ready)
+	{
+		entry.ready = true;
+		readyList.push_back(id);
+	}
+}
+
+void EpollSocketManager::requestSend(CSocketStub* stub)
+{
+	auto it = stubIds.find(stub);
+	if (it != stubIds.end() && it->second != sendingId)
+		markReady(entries[it->second], it->second);
+}
+
+void EpollSocketManager::requestSend(CSocketStub* stub, std::chrono::nanoseconds delay)
+{
+	auto it = stubIds.find(stub);
+	if (it == stubIds.end())
+		return;
+
+	auto& entry = entries[it->second];
+	auto sendAt = clock::now() + delay;
+	if (sendAt < entry.sendAt)
+	{
+		entry.sendAt = sendAt;
+		sendTimers.emplace(sendAt, it->second);
+	}
+}
+
+int EpollSocketManager::getTimeout(int timeout) const
+{
+	if (!readyList.empty())
+		return 0;
+
+	if (!sendTimers.empty())
+	{
+		// Round up, so we don't wake up just before the send is due.
+		auto delay = std::chrono::ceil<std::chrono::milliseconds>(sendTimers.begin()->first - clock::now());
+		timeout = (int)std::clamp<long long>(delay.count(), 0, timeout);
+	}
+
+	return timeout;
+}
+
+void EpollSocketManager::setWakeup(std::chrono::nanoseconds delay)
+{
+	if (timerFd < 0)
+		return;
+
+	// A zero it_value disarms the timer, so always wait at least a nanosecond.
+	if (delay.count() <= 0)
+		delay = std::chrono::nanoseconds(1);
+
+	auto secs = std::chrono::duration_cast<std::chrono::seconds>(delay);
+	itimerspec spec{};
+	spec.it_value.tv_sec = secs.count();
+	spec.it_value.tv_nsec = (delay - secs).count();
+	::timerfd_settime(timerFd, 0, &spec, nullptr);
+}
+
+bool EpollSocketManager::update(long sec, long usec)
+{
+	if (epollFd < 0)
+		return false;
+
+	epoll_event events[MAX_EVENTS];
+	int count = ::epoll_wait(epollFd, events, MAX_EVENTS, getTimeout((int)(sec * 1000 + usec / 1000)));
+
+	// Read events are handled in the order epoll gives them, once per pass so a single
+	// busy client can't starve the others. Writable sockets join the ready list.
+	std::vector<uint64_t> readIds;
+	readIds.reserve(count > 0 ? count : 0);
+	for (int i = 0; i < count; ++i)
+	{
+		if (events[i].data.u64 == TIMER_ID)
+		{
+			uint64_t expirations;
+			while (::read(timerFd, &expirations, sizeof(expirations)) > 0);
+			continue;
+		}
+
+		auto it = entries.find(events[i].data.u64);
+		if (it == entries.end())
+			continue;
+
+		if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+			readIds.push_back(it->first);
+		if (events[i].events & EPOLLOUT)
+			markReady(it->second, it->first);
+	}
+
+	for (auto id : readIds)
+	{
+		auto it = entries.find(id);
+		if (it == entries.end())
+			continue;
+
+		// Nothing else will take the data off a socket that can't receive, so it would be reported every pass.
+		if (!it->second.stub->canRecv() || !it->second.stub->onRecv())
+			dropSocket(id, true);
+	}
+
+	// Throttled sockets whose delay is up.
+	auto now = clock::now();
+	while (!sendTimers.empty() && sendTimers.begin()->first <= now)
+	{
+		auto [sendAt, id] = *sendTimers.begin();
+		sendTimers.erase(sendTimers.begin());
+
+		auto it = entries.find(id);
+		if (it != entries.end() && it->second.sendAt == sendAt)
+		{
+			it->second.sendAt = clock::time_point::max();
+			markReady(it->second, id);
+		}
+	}
+
+	// Callbacks may queue more sockets, they are serviced on the next pass.
+	std::vector<uint64_t> ready;
+	ready.swap(readyList);
+	for (auto id : ready)
+	{
+		auto it = entries.find(id);
+		if (it == entries.end())
+			continue;
+
+		it->second.ready = false;
+		if (it->second.stub->canSend())
+		{
+			sendingId = id;
+			bool sent = it->second.stub->onSend();
+			sendingId = TIMER_ID;
+
+			if (!sent)
+			{
+				dropSocket(id, true);
+				continue;
+			}
+
+			it = entries.find(id);
+			if (it == entries.end())
+				continue;
+		}
+
+		// Anything left over waits for the kernel buffer to drain.
+		setWatchWrite(it->second, id, it->second.stub->canSend());
+	}
+
+	return true;
+}
+
+bool EpollSocketManager::updateSingle(CSocketStub* stub, bool pRead, bool pWrite)
+{
+	if (stub == nullptr)
+		return false;
+
+	int handle = (int)stub->getSocketHandle();
+	if (handle < 0)
+		return false;
+
+	auto fail = [this, stub]() -> bool {
+		auto it = stubIds.find(stub);
+		if (it != stubIds.end())
+			dropSocket(it->second, true);
+		return false;
+	};
+
+	if (pRead && stub->canRecv() && (pollSocket(handle, POLLIN) & (POLLIN | POLLHUP | POLLERR)))
+	{
+		if (!stub->onRecv())
+			return fail();
+	}
+
+	if (pWrite && stub->canSend() && (pollSocket(handle, POLLOUT) & POLLOUT))
+	{
+		if (!stub->onSend())
+			return fail();
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include <sys/stat.h>
+
+#include "Crc32.h"
+#include "FileCache.h"
+
+FileCache::FileCache(size_t pMaxBytes)
+	: maxBytes(pMaxBytes), cachedBytes(0)
+{
+}
+
+std::shared_ptr<const CachedFile> FileCache::get(const CString& pPath)
+{
+	std::string key(pPath.text(), pPath.length());
+	auto it = entries.find(key);
+
+	struct stat fileStat{};
+	if (stat(pPath.text(), &fileStat) == -1)
+	{
+		if (it != entries.end())
+			erase(it->second);
+		return nullptr;
+	}
+
+	if (it != entries.end())
+	{
+		auto entry = it->second;
+		if (entry->file->modTime == fileStat.st_mtime && entry->size == (long long)fileStat.st_size)
+		{
+			lru.splice(lru.begin(), lru, entry);
+			return entry->file;
+		}
+
+		// Changed on disk.
+		erase(entry);
+	}
+
+	auto file = std::make_shared<CachedFile>();
+	file->data.load(pPath);
+	file->modTime = fileStat.st_mtime;
+
+	// Files that would push most of everything else out aren't worth keeping.
+	size_t length = file->data.length();
+	if (length > maxBytes / 4)
+		return file;
+
+	lru.push_front(Entry{ std::move(key), file, (long long)fileStat.st_size });
+	entries[lru.front().path] = lru.begin();
+	cachedBytes += length;
+
+	evict();
+	return file;
+}
+
+std::optional<FileChecksum> FileCache::getChecksum(const CString& pPath)
+{
+	struct stat fileStat{};
+	if (stat(pPath.text(), &fileStat) == -1)
+		return std::nullopt;
+
+	std::string key(pPath.text(), pPath.length());
+	long long size = fileStat.st_size;
+	if (auto checksum = checksums.find(key, size, fileStat.st_mtime); checksum)
+		return FileChecksum{ *checksum, size };
+
+	auto file = get(pPath);
+	if (!file)
+		return std::nullopt;
+
+	uint32_t checksum = utilities::crc32(file->data);
+	checksums.add(key, size, fileStat.st_mtime, checksum);
+	return FileChecksum{ checksum, size };
+}
+
+void FileCache::setMaxBytes(size_t pMaxBytes)
+{
+	maxBytes = pMaxBytes;
+	evict();
+}
+
+void FileCache::clear()
+{
+	lru.clear();
+	entries.clear();
+	cachedBytes = 0;
+}
+
+void FileCache::erase(std::list<Entry>::iterator pEntry)
+{
+	cachedBytes -= pEntry->file->data.length();
+	entries.erase(pEntry->path);
+	lru.erase(pEntry);
+}
+
+void FileCache::evict()
+{
+	while (cachedBytes > maxBytes && !lru.empty())
+		erase(std::prev(lru.end()));
+}
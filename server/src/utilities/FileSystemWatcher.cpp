@@ -0,0 +1,250 @@
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <unordered_set>
+
+#include "CFileSystem.h"
+#include "TServer.h"
+#include "FileSystemWatcher.h"
+
+#ifdef __linux__
+
+// Events that change which files are in a directory.
+static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+
+FileSystemWatcher::FileSystemWatcher(TServer* pServer)
+	: server(pServer), inotifyFd(-1)
+{
+	inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileSystemWatcher::~FileSystemWatcher()
+{
+	if (inotifyFd >= 0)
+		::close(inotifyFd);
+}
+
+bool FileSystemWatcher::addDirectory(CFileSystem* pFileSystem, const CString& pDirectory, bool pRecursive)
+{
+	auto fsIter = fileSystems.try_emplace(pFileSystem, true).first;
+	if (inotifyFd < 0)
+	{
+		fsIter->second = false;
+		return false;
+	}
+
+	// Split the wildcard from the directory.
+	int pos = pDirectory.findl(CFileSystem::getPathSeparator());
+	CString path = CString() << pDirectory.remove(pos) << CFileSystem::getPathSeparator();
+	CString wildcard = pDirectory.subString(pos + 1);
+
+	// Watching the same directory again returns the same descriptor.
+	int wd = ::inotify_add_watch(inotifyFd, path.text(), WATCH_MASK);
+	if (wd < 0)
+	{
+		// Most likely out of watches, so this file system still needs to be resynced.
+		fsIter->second = false;
+		return false;
+	}
+
+	auto& watch = watches[wd];
+	watch.path = path;
+
+	// A rescan adds the directories that are already watched again.
+	for (const auto& target : watch.targets)
+	{
+		if (target.fs == pFileSystem && target.wildcard == wildcard)
+			return true;
+	}
+
+	watch.targets.push_back(WatchTarget{ pFileSystem, wildcard, pRecursive });
+	return true;
+}
+
+void FileSystemWatcher::removeDirectory(CFileSystem* pFileSystem, const CString& pDirectory)
+{
+	int pos = pDirectory.findl(CFileSystem::getPathSeparator());
+	CString path = CString() << pDirectory.remove(pos) << CFileSystem::getPathSeparator();
+	CString wildcard = pDirectory.subString(pos + 1);
+
+	for (auto it = watches.begin(); it != watches.end(); ++it)
+	{
+		if (it->second.path != path)
+			continue;
+
+		auto& targets = it->second.targets;
+		targets.erase(std::remove_if(targets.begin(), targets.end(), [pFileSystem, &wildcard](const WatchTarget& target) { return target.fs == pFileSystem && target.wildcard == wildcard; }), targets.end());
+
+		if (targets.empty())
+		{
+			::inotify_rm_watch(inotifyFd, it->first);
+			watches.erase(it);
+		}
+		return;
+	}
+}
+
+void FileSystemWatcher::removeFileSystem(CFileSystem* pFileSystem)
+{
+	fileSystems.erase(pFileSystem);
+
+	for (auto it = watches.begin(); it != watches.end();)
+	{
+		auto& targets = it->second.targets;
+		targets.erase(std::remove_if(targets.begin(), targets.end(), [pFileSystem](const WatchTarget& target) { return target.fs == pFileSystem; }), targets.end());
+
+		if (targets.empty())
+		{
+			::inotify_rm_watch(inotifyFd, it->first);
+			it = watches.erase(it);
+		}
+		else ++it;
+	}
+}
+
+bool FileSystemWatcher::isWatching(const CFileSystem* pFileSystem) const
+{
+	auto it = fileSystems.find(pFileSystem);
+	return it != fileSystems.end() && it->second;
+}
+
+void FileSystemWatcher::update()
+{
+	if (inotifyFd < 0)
+		return;
+
+	alignas(inotify_event) char buffer[0x4000];
+	ssize_t len;
+	while ((len = ::read(inotifyFd, buffer, sizeof(buffer))) > 0)
+	{
+		for (char* p = buffer; p < buffer + len;)
+		{
+			auto event = (const inotify_event*)p;
+			p += sizeof(inotify_event) + event->len;
+
+			handleEvent(event->wd, event->mask, (event->len > 0 ? event->name : nullptr));
+		}
+	}
+}
+
+void FileSystemWatcher::handleEvent(int pWatch, uint32_t pMask, const char* pName)
+{
+	// The kernel dropped events, so we don't know what changed anymore.
+	if (pMask & IN_Q_OVERFLOW)
+	{
+		resyncAll();
+		return;
+	}
+
+	auto it = watches.find(pWatch);
+	if (it == watches.end())
+		return;
+
+	// The directory was deleted or unmounted.
+	if (pMask & IN_IGNORED)
+	{
+		watches.erase(it);
+		return;
+	}
+
+	// Hidden files are skipped when loading directories too.
+	if (pName == nullptr || pName[0] == '.')
+		return;
+
+	CString name(pName);
+	CString fullPath = CString() << it->second.path << name;
+
+	// Adding a directory registers more watches, so work from a copy.
+	auto targets = it->second.targets;
+
+	if (pMask & IN_ISDIR)
+	{
+		CString dir = CString() << fullPath << CFileSystem::getPathSeparator();
+
+		// Only update each file system once when it watches the directory with several wildcards.
+		std::unordered_set<CFileSystem*> updated;
+		for (const auto& target : targets)
+		{
+			if (!target.recursive || !updated.insert(target.fs).second)
+				continue;
+
+			// A directory moved out of the tree doesn't report its files, so drop everything below it.
+			if (pMask & (IN_CREATE | IN_MOVED_TO))
+				target.fs->addSubDir(dir);
+			else if (pMask & (IN_DELETE | IN_MOVED_FROM))
+				target.fs->removeSubDir(dir);
+		}
+		return;
+	}
+
+	for (const auto& target : targets)
+	{
+		if (!name.match(target.wildcard))
+			continue;
+
+		if (pMask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO))
+			target.fs->addFile(fullPath);
+		else if (pMask & (IN_DELETE | IN_MOVED_FROM))
+		{
+			// File names are shared between directories, so leave it if the file system has it from somewhere else.
+			if (target.fs->find(name) == fullPath)
+				target.fs->removeFile(fullPath);
+		}
+	}
+}
+
+void FileSystemWatcher::resyncAll()
+{
+	std::unordered_set<CFileSystem*> fsList;
+	for (const auto& [wd, watch] : watches)
+	{
+		for (const auto& target : watch.targets)
+			fsList.insert(target.fs);
+	}
+
+	for (auto fs : fsList)
+		fs->resync(true);
+}
+
+#else
+
+FileSystemWatcher::FileSystemWatcher(TServer* pServer)
+	: server(pServer), inotifyFd(-1)
+{
+}
+
+FileSystemWatcher::~FileSystemWatcher() = default;
+
+bool FileSystemWatcher::addDirectory(CFileSystem* pFileSystem, const CString& pDirectory, bool pRecursive)
+{
+	return false;
+}
+
+void FileSystemWatcher::removeDirectory(CFileSystem* pFileSystem, const CString& pDirectory)
+{
+}
+
+void FileSystemWatcher::removeFileSystem(CFileSystem* pFileSystem)
+{
+}
+
+bool FileSystemWatcher::isWatching(const CFileSystem* pFileSystem) const
+{
+	return false;
+}
+
+void FileSystemWatcher::update()
+{
+}
+
+void FileSystemWatcher::handleEvent(int pWatch, uint32_t pMask, const char* pName)
+{
+}
+
+void FileSystemWatcher::resyncAll()
+{
+}
+
+#endif
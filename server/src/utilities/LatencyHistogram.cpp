@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "LatencyHistogram.h"
+
+size_t LatencyHistogram::bucketIndex(uint64_t micros)
+{
+	if (micros < SUB_BUCKETS)
+		return (size_t)micros;
+
+	micros = std::min<uint64_t>(micros, (1ull << MAX_EXPONENT) - 1);
+
+	// The power of two picks the group, the next bits below the top one pick the bucket in it.
+	unsigned exponent = std::bit_width(micros) - 1;
+	size_t group = exponent - SUB_BUCKET_BITS + 1;
+	size_t sub = (micros >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+	return group * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+	if (index < SUB_BUCKETS)
+		return index;
+
+	size_t group = index / SUB_BUCKETS;
+	size_t sub = index % SUB_BUCKETS;
+	unsigned shift = (unsigned)group - 1;
+	return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros)
+{
+	_buckets[bucketIndex(micros)]++;
+	_count++;
+	_total += micros;
+	_max = std::max(_max, micros);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+	if (other.empty())
+		return;
+
+	for (size_t i = 0; i < BUCKETS; i++)
+		_buckets[i] += other._buckets[i];
+
+	_count += other._count;
+	_total += other._total;
+	_max = std::max(_max, other._max);
+}
+
+void LatencyHistogram::clear()
+{
+	_buckets.fill(0);
+	_count = 0;
+	_total = 0;
+	_max = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const
+{
+	if (_count == 0)
+		return 0;
+
+	auto rank = (uint64_t)std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * (double)_count);
+	rank = std::max<uint64_t>(rank, 1);
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKETS; i++)
+	{
+		seen += _buckets[i];
+		if (seen >= rank)
+			return std::min(bucketUpperBound(i), _max);
+	}
+
+	return _max;
+}
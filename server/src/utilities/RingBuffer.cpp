@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cstring>
+
+#include "RingBuffer.h"
+
+RingBuffer::RingBuffer(size_t capacity)
+	: _buffer(capacity > 0 ? capacity : 1), _head(0), _tail(0)
+{
+}
+
+void RingBuffer::write(const char* data, size_t len)
+{
+	if (len == 0)
+		return;
+
+	// Not enough room at the end, so move the unread data back to the front
+	// and grow if that still isn't enough.
+	if (_tail + len > _buffer.size())
+	{
+		size_t used = length();
+		if (_head > 0)
+		{
+			if (used > 0)
+				std::memmove(_buffer.data(), _buffer.data() + _head, used);
+			_head = 0;
+			_tail = used;
+		}
+
+		if (used + len > _buffer.size())
+		{
+			size_t newSize = _buffer.size();
+			while (newSize < used + len)
+				newSize *= 2;
+			_buffer.resize(newSize);
+		}
+	}
+
+	std::memcpy(_buffer.data() + _tail, data, len);
+	_tail += len;
+}
+
+void RingBuffer::consume(size_t len)
+{
+	_head += std::min(len, length());
+
+	// Rewind for free once everything has been read.
+	if (_head == _tail)
+		_head = _tail = 0;
+}
+
+uint16_t RingBuffer::peekShort(size_t offset) const
+{
+	if (offset + 2 > length())
+		return 0;
+
+	auto p = (const unsigned char*)data() + offset;
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
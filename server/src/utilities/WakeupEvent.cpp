@@ -0,0 +1,47 @@
+#include <cstdint>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include "WakeupEvent.h"
+
+WakeupEvent::WakeupEvent(std::function<void()> pCallback)
+	: handle(-1), callback(std::move(pCallback))
+{
+#ifdef __linux__
+	handle = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+WakeupEvent::~WakeupEvent()
+{
+#ifdef __linux__
+	if (handle >= 0)
+		::close(handle);
+#endif
+}
+
+void WakeupEvent::signal()
+{
+#ifdef __linux__
+	if (handle >= 0)
+	{
+		uint64_t one = 1;
+		[[maybe_unused]] auto written = ::write(handle, &one, sizeof(one));
+	}
+#endif
+}
+
+bool WakeupEvent::onRecv()
+{
+#ifdef __linux__
+	uint64_t count;
+	while (::read(handle, &count, sizeof(count)) > 0);
+#endif
+
+	if (callback)
+		callback();
+	return true;
+}
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cctype>
+
 #include "stringutils.h"
 
 namespace utilities
@@ -29,4 +32,11 @@ namespace utilities
 
 		return ret;
 	}
+
+	std::string foldCase(const CString& str)
+	{
+		std::string ret(str.text(), str.length());
+		std::transform(ret.begin(), ret.end(), ret.begin(), [](unsigned char c) { return std::tolower(c); });
+		return ret;
+	}
 }